@@ -0,0 +1,89 @@
+#pragma once
+
+#include "core.h"
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace seed
+{
+	namespace io
+	{
+		// Single file holding many named blobs, see doc/extended3mx.md.
+		// <"3MXA"><uint32 version><blobs><index><uint64 index offset><"3MXA">
+		// the index is rewritten at the end on every Close, of entries with the same name the last one wins.
+		struct ArchiveEntry
+		{
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		class ArchiveWriter
+		{
+		public:
+			///////////////////////////////////////
+			// constructors and destructor
+
+			ArchiveWriter();
+
+			~ArchiveWriter();
+
+			///////////////////////////////////////
+			// public member functions
+
+			// append keeps the entries of an existing archive, new blobs go after them
+			bool Open(const std::string& path, bool append);
+
+			// thread safe
+			bool Append(const std::string& name, const char* data, size_t size);
+
+			bool Contains(const std::string& name);
+
+			// offset and size of the last blob appended as name, false if there is none
+			bool Find(const std::string& name, ArchiveEntry& entry);
+
+			// write the index, the archive is readable from here
+			bool Close();
+
+		private:
+			///////////////////////////////////////
+			// private member functions
+
+			std::string _path;
+			std::fstream _file;
+			std::map<std::string, ArchiveEntry> _entries;
+			uint64_t _end;
+			std::mutex _mutex;
+		};
+
+		class ArchiveReader
+		{
+		public:
+			///////////////////////////////////////
+			// public member functions
+
+			bool Open(const std::string& path);
+
+			std::vector<std::string> Names() const;
+
+			bool Contains(const std::string& name) const;
+
+			// thread safe
+			bool Read(const std::string& name, std::vector<char>& data);
+
+			// "<dir>/<name>.3mxa/<entry>" to archive path and entry name, false if path is not inside an archive
+			static bool SplitPath(const std::string& path, std::string& archivePath, std::string& name);
+
+		private:
+			///////////////////////////////////////
+			// private member functions
+
+			std::string _path;
+			std::ifstream _file;
+			std::map<std::string, ArchiveEntry> _entries;
+			std::mutex _mutex;
+		};
+	}
+}
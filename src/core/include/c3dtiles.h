@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core.h"
+
+#include <vector>
+#include <string>
+
+#include "osg/BoundingBox"
+
+namespace seed
+{
+	namespace io
+	{
+		// one tile of a 3d tiles tileset, see doc/howToUse.md
+		struct Tile3dtiles
+		{
+			osg::BoundingBox bb;
+			double geometricError = 0.;
+			std::string content;				// uri relative to the tileset, empty for a tile without content
+			std::vector<Tile3dtiles> children;
+		};
+
+		// encode pointNum xyz + rgb into a "pnts" tile, positions are quantized to 16 bits over their bounding box
+		void GeneratePnts(const float* xyz, const unsigned char* rgb, int pointNum, std::vector<char>& buffer);
+
+		bool GeneratePnts(const float* xyz, const unsigned char* rgb, int pointNum, const std::string& output);
+
+		// tileset.json with root as the root tile, refined by adding children, a non zero offset becomes the root transform
+		bool GenerateTileset(const Tile3dtiles& root, osg::Vec3d offset, const std::string& output);
+
+		// same with a column major root transform, none if transform is null
+		bool GenerateTileset(const Tile3dtiles& root, const double* transform, const std::string& output);
+
+		// column major transform from east north up meters at lon, lat in degrees and height on the WGS84 ellipsoid to geocentric EPSG:4978
+		void EastNorthUpToEcef(double lon, double lat, double height, double* transform);
+	}
+}
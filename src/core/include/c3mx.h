@@ -14,6 +14,47 @@ namespace seed
 {
 	namespace io
 	{
+		struct Node3mx
+		{
+			std::string id;
+			osg::BoundingBox bb;
+			float maxScreenDiameter;
+			std::vector<std::string> children;
+			std::vector<std::string> resources;
+		};
+
+		struct Resource3mx
+		{
+			std::string type;
+			std::string format;
+			std::string id;
+
+			std::string texture;
+			float pointSize;
+			osg::BoundingBox bb;
+
+			std::vector<char> bufferData;
+		};
+
+		// flags of the quantized pointcloud resource "xyzq", see doc/extended3mx.md
+		enum QuantizedPointFlags
+		{
+			QUANTIZED_MORTON_DELTA = 1,		// points in morton order, positions stored as deltas to the previous point
+			QUANTIZED_LZMA = 2				// payload compressed by lzma
+		};
+
+		// encode pointNum xyz + rgba into an "xyzq" buffer, bb receives the resource bounding box
+		bool PointCloudToQuantizedBuffer(const float* xyz, const unsigned char* rgba, int pointNum, unsigned int flags,
+			std::vector<char>& bufferData, osg::BoundingBox& bb);
+
+		// decode an "xyzq" buffer, the points may come in another order than encoded
+		bool QuantizedBufferToPointCloud(const char* bufferData, size_t size, std::vector<float>& xyz, std::vector<unsigned char>& rgba);
+
+		bool Generate3mxb(const std::vector<Node3mx>& nodes, const std::vector<Resource3mx>& resourcesGeometry, const std::vector<Resource3mx>& resourcesTexture, const std::string& output);
+
+		// same content as the file, for an archive entry
+		void Generate3mxb(const std::vector<Node3mx>& nodes, const std::vector<Resource3mx>& resourcesGeometry, const std::vector<Resource3mx>& resourcesTexture, std::vector<char>& buffer);
+
 		bool ConvertOsgbTo3mxb(osg::ref_ptr<osg::Node> osgNode, const std::string& output, osg::BoundingBox* pbb = nullptr);
 
 		bool Generate3mxbRoot(const std::vector<std::string>& tileIds, const std::vector<std::string>& tileRelativePaths, const std::vector<osg::BoundingBox>& tileBBoxes, const std::string& output);
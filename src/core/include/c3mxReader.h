@@ -0,0 +1,134 @@
+#pragma once
+
+#include "core.h"
+
+#include <cstdint>
+#include <mutex>
+
+namespace seed
+{
+	namespace io
+	{
+		// Read only file mapped into memory, CreateFileMapping on windows, mmap elsewhere.
+		class MappedFile
+		{
+		public:
+			///////////////////////////////////////
+			// constructors and destructor
+
+			MappedFile();
+
+			~MappedFile();
+
+			MappedFile(const MappedFile&) = delete;
+
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			///////////////////////////////////////
+			// public member functions
+
+			bool Open(const std::string& path);
+
+			void Close();
+
+			const char* Data() const { return _data; }
+
+			size_t Size() const { return _size; }
+
+		private:
+			///////////////////////////////////////
+			// private member functions
+
+#ifdef _WIN32
+			void* _file;
+			void* _mapping;
+#else
+			int _file;
+#endif
+			const char* _data;
+			size_t _size;
+		};
+
+		// node of a 3mxb header, without osg types
+		struct NodeView3mx
+		{
+			std::string id;
+			float bbMin[3];
+			float bbMax[3];
+			float maxScreenDiameter;
+			std::vector<std::string> children;
+			std::vector<std::string> resources;
+		};
+
+		// resource of a 3mxb header, data points into the file, it is not aligned
+		struct ResourceView3mx
+		{
+			std::string type;
+			std::string format;
+			std::string id;
+			std::string texture;
+			float pointSize;
+			float bbMin[3];
+			float bbMax[3];
+			const char* data;
+			size_t size;
+		};
+
+		// points of an "xyz" resource in place, see doc/extended3mx.md. xyz and rgba are not aligned, read them by memcpy
+		struct PointCloudView3mx
+		{
+			int pointNum;
+			const char* xyz;
+			const unsigned char* rgba;
+		};
+
+		// Zero copy reader of 3mxb files. Open only checks the file, the json header is parsed on the first
+		// access to nodes or resources. Views stay valid while the reader is open.
+		class Reader3mxb
+		{
+		public:
+			///////////////////////////////////////
+			// public member functions
+
+			bool Open(const std::string& path);
+
+			// a 3mxb in memory owned by the caller, e.g. an archive entry
+			bool Open(const char* data, size_t size);
+
+			void Close();
+
+			// raw json header
+			std::string Header() const;
+
+			const std::vector<NodeView3mx>& Nodes();
+
+			const std::vector<ResourceView3mx>& Resources();
+
+			const ResourceView3mx* FindResource(const std::string& id);
+
+			// false if the header or the buffers are broken
+			bool Valid();
+
+			// "xyz" resources only, "xyzq" ones decode by QuantizedBufferToPointCloud of c3mx
+			static bool PointCloud(const ResourceView3mx& resource, PointCloudView3mx& view);
+
+		private:
+			///////////////////////////////////////
+			// private member functions
+
+			bool Attach(const char* data, size_t size);
+
+			void ParseHeader();
+
+			MappedFile _file;
+			const char* _data = nullptr;
+			size_t _size = 0;
+			uint32_t _headerLength = 0;
+			std::string _path;
+			std::unique_ptr<std::once_flag> _parsed;
+			bool _valid = false;
+			std::vector<NodeView3mx> _nodes;
+			std::vector<ResourceView3mx> _resources;
+		};
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "core.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// Appends json text to a string in one pass, without building a tree first.
+		// The text is the same neb::CJsonObject::ToString, or ToFormattedString if formatted, gives.
+		class JsonWriter
+		{
+		public:
+			///////////////////////////////////////
+			// constructors and destructor
+
+			JsonWriter(std::string& output, bool formatted = false);
+
+			///////////////////////////////////////
+			// public member functions
+
+			void StartObject();
+
+			void EndObject();
+
+			void StartArray();
+
+			void EndArray();
+
+			// inside an object, before each value
+			void Key(const std::string& key);
+
+			void String(const std::string& value);
+
+			void Double(double value);
+
+			void Int(long long value);
+
+			void Uint(unsigned long long value);
+
+			void Bool(bool value);
+
+			// key and value
+			template<class T> void Member(const std::string& key, const T& value)
+			{
+				Key(key);
+				Value(value);
+			}
+
+			// [x, y, z]
+			void Vec3(double x, double y, double z);
+
+		private:
+			///////////////////////////////////////
+			// private member functions
+
+			void Value(const std::string& value) { String(value); }
+			void Value(bool value) { Bool(value); }
+			void Value(const char* value) { String(value); }
+			void Value(double value) { Double(value); }
+			void Value(float value) { Double(value); }
+			void Value(int value) { Int(value); }
+			void Value(unsigned int value) { Uint(value); }
+			void Value(long value) { Int(value); }
+			void Value(long long value) { Int(value); }
+			void Value(unsigned long long value) { Uint(value); }
+			void Value(unsigned long value) { Uint(value); }
+
+			// separator before a value in an array
+			void Separate();
+
+			void Indent(size_t depth);
+
+			struct Scope
+			{
+				bool array;
+				bool empty;
+			};
+
+			std::string& _output;
+			bool _formatted;
+			std::vector<Scope> _scopes;
+		};
+	}
+}
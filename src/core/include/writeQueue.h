@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace seed
+{
+	namespace io
+	{
+		// Bounded queue of write tasks consumed by a pool of writer threads.
+		// Push blocks while the queue is full, so producers can not run ahead of the disk.
+		class WriteQueue
+		{
+		public:
+			///////////////////////////////////////
+			// constructors and destructor
+
+			// numThreads == 0 runs every task inline in Push
+			WriteQueue(unsigned int numThreads, size_t capacity);
+
+			~WriteQueue();
+
+			///////////////////////////////////////
+			// public member functions
+
+			// task returns false on failure
+			void Push(std::function<bool()> task);
+
+			// wait until all pushed tasks are done, return false if any of them failed
+			bool Flush();
+
+		private:
+			///////////////////////////////////////
+			// private member functions
+
+			void Run();
+
+			std::vector<std::thread> _threads;
+			std::deque<std::function<bool()>> _tasks;
+			std::mutex _mutex;
+			std::condition_variable _conditionPush;
+			std::condition_variable _conditionPop;
+			std::condition_variable _conditionIdle;
+			size_t _capacity;
+			size_t _running;
+			bool _stop;
+			std::atomic_bool _failed;
+		};
+	}
+}
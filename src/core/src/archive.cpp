@@ -0,0 +1,250 @@
+#include "archive.h"
+
+#include <cstring>
+
+namespace seed
+{
+	namespace io
+	{
+		static const char archiveMagic[4] = { '3', 'M', 'X', 'A' };
+		static const uint32_t archiveVersion = 1;
+
+		// index offset and entries from the footer, file is left anywhere
+		static bool ReadIndex(std::istream& file, std::map<std::string, ArchiveEntry>& entries, uint64_t& indexOffset)
+		{
+			char magic[4];
+			uint32_t version;
+			file.seekg(0, std::ios::end);
+			uint64_t fileSize = file.tellg();
+			file.seekg(0, std::ios::beg);
+			file.read(magic, 4);
+			file.read((char*)&version, 4);
+			if (!file.good() || memcmp(magic, archiveMagic, 4) != 0 || version != archiveVersion || fileSize < 20)
+			{
+				return false;
+			}
+
+			file.seekg(fileSize - 12, std::ios::beg);
+			file.read((char*)&indexOffset, 8);
+			file.read(magic, 4);
+			if (!file.good() || memcmp(magic, archiveMagic, 4) != 0 || indexOffset < 8 || indexOffset > fileSize - 12)
+			{
+				return false;
+			}
+
+			// <uint32 count>{<uint32 name length><name><uint64 offset><uint64 size>}
+			uint32_t count;
+			file.seekg(indexOffset, std::ios::beg);
+			file.read((char*)&count, 4);
+			entries.clear();
+			for (uint32_t i = 0; i < count && file.good(); ++i)
+			{
+				uint32_t nameLength;
+				file.read((char*)&nameLength, 4);
+				if (!file.good() || nameLength > fileSize)
+				{
+					return false;
+				}
+				std::string name(nameLength, '\0');
+				file.read(&name[0], nameLength);
+				ArchiveEntry entry;
+				file.read((char*)&entry.offset, 8);
+				file.read((char*)&entry.size, 8);
+				if (entry.offset + entry.size > indexOffset)
+				{
+					return false;
+				}
+				entries[name] = entry;
+			}
+			return file.good();
+		}
+
+		ArchiveWriter::ArchiveWriter() :
+			_end(0)
+		{
+		}
+
+		ArchiveWriter::~ArchiveWriter()
+		{
+			if (_file.is_open())
+			{
+				Close();
+			}
+		}
+
+		bool ArchiveWriter::Open(const std::string& path, bool append)
+		{
+			std::lock_guard<std::mutex> lck(_mutex);
+			_path = path;
+			_entries.clear();
+			if (append)
+			{
+				_file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+				if (_file.is_open())
+				{
+					// blobs go after the old index, readers of the old footer stay valid until Close
+					uint64_t indexOffset;
+					if (!ReadIndex(_file, _entries, indexOffset))
+					{
+						seed::log::DumpLog(seed::log::Critical, "%s is NOT a valid archive!", path.c_str());
+						_file.close();
+						return false;
+					}
+					_file.clear();
+					_file.seekp(0, std::ios::end);
+					_end = _file.tellp();
+					return true;
+				}
+			}
+
+			_file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+			if (!_file.is_open())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			_file.write(archiveMagic, 4);
+			_file.write((char*)&archiveVersion, 4);
+			_end = 8;
+			return _file.good();
+		}
+
+		bool ArchiveWriter::Append(const std::string& name, const char* data, size_t size)
+		{
+			std::lock_guard<std::mutex> lck(_mutex);
+			if (!_file.is_open())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Archive %s is NOT open!", _path.c_str());
+				return false;
+			}
+			_file.seekp(_end, std::ios::beg);
+			_file.write(data, size);
+			if (!_file.good())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing %s to %s!", name.c_str(), _path.c_str());
+				return false;
+			}
+			_entries[name] = ArchiveEntry{ _end, size };
+			_end += size;
+			return true;
+		}
+
+		bool ArchiveWriter::Contains(const std::string& name)
+		{
+			std::lock_guard<std::mutex> lck(_mutex);
+			return _entries.find(name) != _entries.end();
+		}
+
+		bool ArchiveWriter::Find(const std::string& name, ArchiveEntry& entry)
+		{
+			std::lock_guard<std::mutex> lck(_mutex);
+			auto it = _entries.find(name);
+			if (it == _entries.end())
+			{
+				return false;
+			}
+			entry = it->second;
+			return true;
+		}
+
+		bool ArchiveWriter::Close()
+		{
+			std::lock_guard<std::mutex> lck(_mutex);
+			if (!_file.is_open())
+			{
+				return false;
+			}
+			_file.seekp(_end, std::ios::beg);
+			uint32_t count = _entries.size();
+			_file.write((char*)&count, 4);
+			for (const auto& entry : _entries)
+			{
+				uint32_t nameLength = entry.first.size();
+				_file.write((char*)&nameLength, 4);
+				_file.write(entry.first.data(), nameLength);
+				_file.write((char*)&entry.second.offset, 8);
+				_file.write((char*)&entry.second.size, 8);
+			}
+			_file.write((char*)&_end, 8);
+			_file.write(archiveMagic, 4);
+			bool good = _file.good();
+			_file.close();
+			if (!good)
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing the index of %s!", _path.c_str());
+			}
+			return good;
+		}
+
+		bool ArchiveReader::Open(const std::string& path)
+		{
+			std::lock_guard<std::mutex> lck(_mutex);
+			_path = path;
+			_file.open(path, std::ios::in | std::ios::binary);
+			if (!_file.is_open())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			uint64_t indexOffset;
+			if (!ReadIndex(_file, _entries, indexOffset))
+			{
+				seed::log::DumpLog(seed::log::Critical, "%s is NOT a valid archive!", path.c_str());
+				_file.close();
+				return false;
+			}
+			return true;
+		}
+
+		std::vector<std::string> ArchiveReader::Names() const
+		{
+			std::vector<std::string> names;
+			for (const auto& entry : _entries)
+			{
+				names.push_back(entry.first);
+			}
+			return names;
+		}
+
+		bool ArchiveReader::Contains(const std::string& name) const
+		{
+			return _entries.find(name) != _entries.end();
+		}
+
+		bool ArchiveReader::Read(const std::string& name, std::vector<char>& data)
+		{
+			auto entry = _entries.find(name);
+			if (entry == _entries.end())
+			{
+				return false;
+			}
+			std::lock_guard<std::mutex> lck(_mutex);
+			data.resize(entry->second.size);
+			_file.clear();
+			_file.seekg(entry->second.offset, std::ios::beg);
+			_file.read(data.data(), data.size());
+			if (!_file.good())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while reading %s from %s!", name.c_str(), _path.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool ArchiveReader::SplitPath(const std::string& path, std::string& archivePath, std::string& name)
+		{
+			size_t pos = path.find(".3mxa/");
+			if (pos == std::string::npos)
+			{
+				pos = path.find(".3mxa\\");
+			}
+			if (pos == std::string::npos)
+			{
+				return false;
+			}
+			archivePath = path.substr(0, pos + 5);
+			name = path.substr(pos + 6);
+			return true;
+		}
+	}
+}
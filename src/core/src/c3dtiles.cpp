@@ -0,0 +1,213 @@
+#include "c3dtiles.h"
+#include "jsonWriter.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+
+namespace seed
+{
+	namespace io
+	{
+		static void WriteBoundingVolume(JsonWriter& writer, const osg::BoundingBox& bb)
+		{
+			// center and the three half axes
+			osg::Vec3 center = bb.center();
+			osg::Vec3 half = (bb._max - bb._min) * 0.5f;
+			writer.Key("boundingVolume");
+			writer.StartObject();
+			writer.Key("box");
+			writer.StartArray();
+			double box[12] = { center.x(), center.y(), center.z(), half.x(), 0, 0, 0, half.y(), 0, 0, 0, half.z() };
+			for (double value : box)
+			{
+				writer.Double(value);
+			}
+			writer.EndArray();
+			writer.EndObject();
+		}
+
+		static void WriteTile(JsonWriter& writer, const Tile3dtiles& tile);
+
+		static void WriteTileMembers(JsonWriter& writer, const Tile3dtiles& tile)
+		{
+			WriteBoundingVolume(writer, tile.bb);
+			writer.Member("geometricError", tile.geometricError);
+			if (!tile.content.empty())
+			{
+				writer.Key("content");
+				writer.StartObject();
+				writer.Member("uri", tile.content);
+				writer.EndObject();
+			}
+			if (tile.children.size())
+			{
+				writer.Key("children");
+				writer.StartArray();
+				for (const auto& child : tile.children)
+				{
+					WriteTile(writer, child);
+				}
+				writer.EndArray();
+			}
+		}
+
+		static void WriteTile(JsonWriter& writer, const Tile3dtiles& tile)
+		{
+			writer.StartObject();
+			WriteTileMembers(writer, tile);
+			writer.EndObject();
+		}
+
+		void GeneratePnts(const float* xyz, const unsigned char* rgb, int pointNum, std::vector<char>& buffer)
+		{
+			osg::BoundingBox bb;
+			for (int i = 0; i < pointNum; ++i)
+			{
+				bb.expandBy(osg::Vec3(xyz[3 * i + 0], xyz[3 * i + 1], xyz[3 * i + 2]));
+			}
+			osg::Vec3 scale = bb.valid() ? bb._max - bb._min : osg::Vec3(0, 0, 0);
+
+			// feature table: POSITION_QUANTIZED at 0, RGB after it, both tightly packed
+			size_t positionSize = pointNum * 3 * sizeof(unsigned short);
+			size_t rgbSize = pointNum * 3;
+			thread_local std::string jsonStr;
+			jsonStr.clear();
+			JsonWriter writer(jsonStr);
+			writer.StartObject();
+			writer.Member("POINTS_LENGTH", pointNum);
+			writer.Key("POSITION_QUANTIZED");
+			writer.StartObject();
+			writer.Member("byteOffset", 0);
+			writer.EndObject();
+			writer.Key("RGB");
+			writer.StartObject();
+			writer.Member("byteOffset", (unsigned long long)positionSize);
+			writer.EndObject();
+			writer.Key("QUANTIZED_VOLUME_OFFSET");
+			writer.Vec3(bb.valid() ? bb.xMin() : 0., bb.valid() ? bb.yMin() : 0., bb.valid() ? bb.zMin() : 0.);
+			writer.Key("QUANTIZED_VOLUME_SCALE");
+			writer.Vec3(scale.x(), scale.y(), scale.z());
+			writer.EndObject();
+
+			// the json is padded with spaces and the binary body with zeros to 8 byte boundaries
+			const size_t headerSize = 28;
+			size_t jsonSize = (headerSize + jsonStr.size() + 7) / 8 * 8 - headerSize;
+			size_t binarySize = (positionSize + rgbSize + 7) / 8 * 8;
+			jsonStr.resize(jsonSize, ' ');
+
+			buffer.assign(headerSize + jsonSize + binarySize, 0);
+			char* out = buffer.data();
+			uint32_t header[7] = { 0, 1, (uint32_t)buffer.size(), (uint32_t)jsonSize, (uint32_t)binarySize, 0, 0 };
+			memcpy(header, "pnts", 4);
+			memcpy(out, header, headerSize);
+			memcpy(out + headerSize, jsonStr.data(), jsonSize);
+
+			unsigned short* position = (unsigned short*)(out + headerSize + jsonSize);
+			for (int i = 0; i < pointNum; ++i)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					float q = scale[k] > 0 ? (xyz[3 * i + k] - bb._min[k]) / scale[k] * 65535.f : 0.f;
+					position[3 * i + k] = (unsigned short)std::min(65535.f, std::max(0.f, std::round(q)));
+				}
+			}
+			memcpy(out + headerSize + jsonSize + positionSize, rgb, rgbSize);
+		}
+
+		bool GeneratePnts(const float* xyz, const unsigned char* rgb, int pointNum, const std::string& output)
+		{
+			thread_local std::vector<char> buffer;
+			GeneratePnts(xyz, rgb, pointNum, buffer);
+
+			std::ofstream outfile(output, std::ios::out | std::ios::binary);
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
+				return false;
+			}
+			outfile.write(buffer.data(), buffer.size());
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool GenerateTileset(const Tile3dtiles& root, osg::Vec3d offset, const std::string& output)
+		{
+			if (std::abs(offset.x()) > DBL_EPSILON || std::abs(offset.y()) > DBL_EPSILON || std::abs(offset.z()) > DBL_EPSILON)
+			{
+				double transform[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, offset.x(), offset.y(), offset.z(), 1 };
+				return GenerateTileset(root, transform, output);
+			}
+			return GenerateTileset(root, (const double*)nullptr, output);
+		}
+
+		bool GenerateTileset(const Tile3dtiles& root, const double* transform, const std::string& output)
+		{
+			std::string jsonStr;
+			JsonWriter writer(jsonStr, true);
+			writer.StartObject();
+			writer.Key("asset");
+			writer.StartObject();
+			writer.Member("version", "1.0");
+			writer.Member("generator", "ProjSEED/lodToolkit");
+			writer.EndObject();
+			writer.Member("geometricError", root.geometricError);
+
+			// the root tile carries the transform and the refinement inherited by all tiles below
+			writer.Key("root");
+			writer.StartObject();
+			if (transform)
+			{
+				writer.Key("transform");
+				writer.StartArray();
+				for (int i = 0; i < 16; ++i)
+				{
+					writer.Double(transform[i]);
+				}
+				writer.EndArray();
+			}
+			writer.Member("refine", "ADD");
+			WriteTileMembers(writer, root);
+			writer.EndObject();
+			writer.EndObject();
+
+			std::ofstream outfile(output);
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
+				return false;
+			}
+			outfile << jsonStr;
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		void EastNorthUpToEcef(double lon, double lat, double height, double* transform)
+		{
+			// WGS84
+			const double a = 6378137.;
+			const double f = 1. / 298.257223563;
+			const double e2 = f * (2. - f);
+			const double degree = std::acos(-1.) / 180.;
+			double sinLon = std::sin(lon * degree), cosLon = std::cos(lon * degree);
+			double sinLat = std::sin(lat * degree), cosLat = std::cos(lat * degree);
+			double n = a / std::sqrt(1. - e2 * sinLat * sinLat);
+			double axes[16] = {
+				-sinLon, cosLon, 0., 0.,									// east
+				-sinLat * cosLon, -sinLat * sinLon, cosLat, 0.,				// north
+				cosLat * cosLon, cosLat * sinLon, sinLat, 0.,				// up
+				(n + height) * cosLat * cosLon, (n + height) * cosLat * sinLon, (n * (1. - e2) + height) * sinLat, 1. };
+			memcpy(transform, axes, sizeof(axes));
+		}
+	}
+}
@@ -23,7 +23,15 @@
 #include "dxt_img.h"
 #include "stb_image_write.h"
 #include "openctm.h"
-#include "CJsonObject.hpp"
+#include "jsonWriter.h"
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include "LzmaLib.h"
+
+#include <cmath>
+#include <cstring>
+#include <numeric>
 
 namespace seed
 {
@@ -66,113 +74,96 @@ namespace seed
 			std::map<osg::Geometry*, osg::Texture*> texture_map;
 		};
 
-		struct Node3mx
-		{
-			std::string id;
-			osg::BoundingBox bb;
-			float maxScreenDiameter;
-			std::vector<std::string> children;
-			std::vector<std::string> resources;
-		};
-
-		struct Resource3mx
+		static void WriteNodeJson(JsonWriter& writer, const Node3mx& node)
 		{
-			std::string type;
-			std::string format;
-			std::string id;
-
-			std::string texture;
-			float pointSize;
-			osg::BoundingBox bb;
-
-			std::vector<char> bufferData;
-		};
-
-		neb::CJsonObject NodeToJson(const Node3mx& node)
-		{
-			neb::CJsonObject oJson;
-			oJson.Add("id", node.id);
-
-			oJson.AddEmptySubArray("bbMin");
-			oJson["bbMin"].Add(node.bb.xMin());
-			oJson["bbMin"].Add(node.bb.yMin());
-			oJson["bbMin"].Add(node.bb.zMin());
-
-			oJson.AddEmptySubArray("bbMax");
-			oJson["bbMax"].Add(node.bb.xMax());
-			oJson["bbMax"].Add(node.bb.yMax());
-			oJson["bbMax"].Add(node.bb.zMax());
-
-			oJson.Add("maxScreenDiameter", node.maxScreenDiameter);
-
-			oJson.AddEmptySubArray("children");
-			for (auto child : node.children)
+			writer.StartObject();
+			writer.Member("id", node.id);
+			writer.Key("bbMin");
+			writer.Vec3(node.bb.xMin(), node.bb.yMin(), node.bb.zMin());
+			writer.Key("bbMax");
+			writer.Vec3(node.bb.xMax(), node.bb.yMax(), node.bb.zMax());
+			writer.Member("maxScreenDiameter", node.maxScreenDiameter);
+
+			writer.Key("children");
+			writer.StartArray();
+			for (const auto& child : node.children)
 			{
-				oJson["children"].Add(child);
+				writer.String(child);
 			}
+			writer.EndArray();
 
-			oJson.AddEmptySubArray("resources");
-			for (auto resource : node.resources)
+			writer.Key("resources");
+			writer.StartArray();
+			for (const auto& resource : node.resources)
 			{
-				oJson["resources"].Add(resource);
+				writer.String(resource);
 			}
-			return oJson;
+			writer.EndArray();
+			writer.EndObject();
 		}
 
-		neb::CJsonObject ResourceToJson(const Resource3mx& resource)
+		static void WriteResourceJson(JsonWriter& writer, const Resource3mx& resource)
 		{
-			neb::CJsonObject oJson;
-			oJson.Add("type", resource.type);
-			oJson.Add("format", resource.format);
-			oJson.Add("id", resource.id);
+			writer.StartObject();
+			writer.Member("type", resource.type);
+			writer.Member("format", resource.format);
+			writer.Member("id", resource.id);
 			if (resource.type == "geometryBuffer")
 			{
 				if (resource.format == "ctm")
 				{
-					oJson.Add("texture", resource.texture);
+					writer.Member("texture", resource.texture);
 				}
-				else if (resource.format == "xyz")
+				else if (resource.format == "xyz" || resource.format == "xyzq")
 				{
-					oJson.Add("pointSize", resource.pointSize);
+					writer.Member("pointSize", resource.pointSize);
 				}
-
-				oJson.AddEmptySubArray("bbMin");
-				oJson["bbMin"].Add(resource.bb.xMin());
-				oJson["bbMin"].Add(resource.bb.yMin());
-				oJson["bbMin"].Add(resource.bb.zMin());
-
-				oJson.AddEmptySubArray("bbMax");
-				oJson["bbMax"].Add(resource.bb.xMax());
-				oJson["bbMax"].Add(resource.bb.yMax());
-				oJson["bbMax"].Add(resource.bb.zMax());
+				writer.Key("bbMin");
+				writer.Vec3(resource.bb.xMin(), resource.bb.yMin(), resource.bb.zMin());
+				writer.Key("bbMax");
+				writer.Vec3(resource.bb.xMax(), resource.bb.yMax(), resource.bb.zMax());
 			}
-			oJson.Add("size", resource.bufferData.size());
-			return oJson;
+			writer.Member("size", (unsigned long long)resource.bufferData.size());
+			writer.EndObject();
 		}
 
-		bool Generate3mxb(const std::vector<Node3mx>& nodes, const std::vector<Resource3mx>& resourcesGeometry, const std::vector<Resource3mx>& resourcesTexture, const std::string& output)
+		// one pass over nodes and resources, a CJsonObject tree costs O(n^2) to append to
+		static void Generate3mxbHeader(const std::vector<Node3mx>& nodes, const std::vector<Resource3mx>& resourcesGeometry, const std::vector<Resource3mx>& resourcesTexture,
+			std::string& jsonStr)
 		{
-			neb::CJsonObject oJson;
-			oJson.Add("version", 1);
-
-			oJson.AddEmptySubArray("nodes");
+			jsonStr.clear();
+			jsonStr.reserve(256 * (nodes.size() + resourcesGeometry.size() + resourcesTexture.size()) + 64);
+			JsonWriter writer(jsonStr);
+			writer.StartObject();
+			writer.Member("version", 1);
+
+			writer.Key("nodes");
+			writer.StartArray();
 			for (const auto& node : nodes)
 			{
-				oJson["nodes"].Add(NodeToJson(node));
+				WriteNodeJson(writer, node);
 			}
+			writer.EndArray();
 
-			oJson.AddEmptySubArray("resources");
+			writer.Key("resources");
+			writer.StartArray();
 			for (const auto& resource : resourcesTexture)
 			{
-				oJson["resources"].Add(ResourceToJson(resource));
+				WriteResourceJson(writer, resource);
 			}
 			for (const auto& resource : resourcesGeometry)
 			{
-				oJson["resources"].Add(ResourceToJson(resource));
+				WriteResourceJson(writer, resource);
 			}
+			writer.EndArray();
+			writer.EndObject();
+		}
 
-			std::string jsonStr = oJson.ToString();
-			uint32_t length = jsonStr.size();
+		bool Generate3mxb(const std::vector<Node3mx>& nodes, const std::vector<Resource3mx>& resourcesGeometry, const std::vector<Resource3mx>& resourcesTexture, const std::string& output)
+		{
+			// the whole file in one buffer of this thread, written with one call
+			thread_local std::vector<char> buffer;
+			Generate3mxb(nodes, resourcesGeometry, resourcesTexture, buffer);
 
 			std::ofstream outfile(output, std::ios::out | std::ios::binary);
 			if (outfile.bad())
@@ -180,18 +171,13 @@ namespace seed
 				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
 				return false;
 			}
+			outfile.write(buffer.data(), buffer.size());
 
-			outfile.write("3MXBO", 5);
-			outfile.write((char*)&length, 4);
-			outfile.write(jsonStr.c_str(), length);
-
-			for (const auto& resource : resourcesTexture)
+			// do not hold on to the memory of an exceptionally large file
+			const size_t maxScratchSize = 64 << 20;
+			if (buffer.capacity() > maxScratchSize)
 			{
-				outfile.write(resource.bufferData.data(), resource.bufferData.size());
-			}
-			for (const auto& resource : resourcesGeometry)
-			{
-				outfile.write(resource.bufferData.data(), resource.bufferData.size());
+				std::vector<char>().swap(buffer);
 			}
 
 			if (outfile.bad())
@@ -202,11 +188,45 @@ namespace seed
 			return true;
 		}
 
+		void Generate3mxb(const std::vector<Node3mx>& nodes, const std::vector<Resource3mx>& resourcesGeometry, const std::vector<Resource3mx>& resourcesTexture, std::vector<char>& buffer)
+		{
+			thread_local std::string jsonStr;
+			Generate3mxbHeader(nodes, resourcesGeometry, resourcesTexture, jsonStr);
+			uint32_t length = jsonStr.size();
+
+			size_t size = 5 + 4 + length;
+			for (const auto& resource : resourcesTexture)
+			{
+				size += resource.bufferData.size();
+			}
+			for (const auto& resource : resourcesGeometry)
+			{
+				size += resource.bufferData.size();
+			}
+			buffer.resize(size);
+			char* out = buffer.data();
+			memcpy(out, "3MXBO", 5);
+			memcpy(out + 5, &length, 4);
+			memcpy(out + 9, jsonStr.data(), length);
+			out += 9 + length;
+			for (const auto& resource : resourcesTexture)
+			{
+				memcpy(out, resource.bufferData.data(), resource.bufferData.size());
+				out += resource.bufferData.size();
+			}
+			for (const auto& resource : resourcesGeometry)
+			{
+				memcpy(out, resource.bufferData.data(), resource.bufferData.size());
+				out += resource.bufferData.size();
+			}
+		}
+
 		bool Generate3mxbRoot(const std::vector<std::string>& tileIds, const std::vector<std::string>& tileRelativePaths, const std::vector<osg::BoundingBox>& tileBBoxes, const std::string& output)
 		{
 			std::vector<Node3mx> nodes;
 			std::vector<Resource3mx> resourcesGeometry;
 			std::vector<Resource3mx> resourcesTexture;
+			nodes.reserve(tileIds.size());
 
 			for (int i = 0; i < tileIds.size(); ++i)
 			{
@@ -218,7 +238,7 @@ namespace seed
 				node.maxScreenDiameter = 0;
 				node.children.push_back(tileRelativePaths[i]);
 				node.bb = tileBBoxes[i];
-				nodes.push_back(node);
+				nodes.push_back(std::move(node));
 			}
 
 			return Generate3mxb(nodes, resourcesGeometry, resourcesTexture, output);
@@ -248,37 +268,40 @@ namespace seed
 
 		bool Generate3mx(const std::string& srs, osg::Vec3d srsOrigin, osg::Vec3d offset, const std::string& outputDataRootRelative, const std::string& output)
 		{
-			neb::CJsonObject oJson;
-			oJson.Add("3mxVersion", 1);
-			oJson.Add("name", "Root");
-			oJson.Add("description", "Generated by ProjSEED/lodToolkit, copyright <a href='https://github.com/ProjSEED/lodToolkit' target='_blank'>ProjSEED</a>.");
-			oJson.Add("logo", "logo.png");
-
-			neb::CJsonObject oJsonSceneOption;
-			oJsonSceneOption.Add("navigationMode", "ORBIT");
-			oJson.AddEmptySubArray("sceneOptions");
-			oJson["sceneOptions"].Add(oJsonSceneOption);
-
-			neb::CJsonObject oJsonLayer;
-			oJsonLayer.Add("type", "meshPyramid");
-			oJsonLayer.Add("id", "model0");
-			oJsonLayer.Add("name", "Root");
-			oJsonLayer.Add("description", "Converted by ProjSEED/lodToolkit, copyright <a href='https://github.com/ProjSEED/lodToolkit' target='_blank'>ProjSEED</a>.");
-			oJsonLayer.Add("SRS", srs);
-			oJsonLayer.AddEmptySubArray("SRSOrigin");
-			oJsonLayer["SRSOrigin"].Add(srsOrigin.x());
-			oJsonLayer["SRSOrigin"].Add(srsOrigin.y());
-			oJsonLayer["SRSOrigin"].Add(srsOrigin.z());
+			std::string jsonStr;
+			JsonWriter writer(jsonStr, true);
+			writer.StartObject();
+			writer.Member("3mxVersion", 1);
+			writer.Member("name", "Root");
+			writer.Member("description", "Generated by ProjSEED/lodToolkit, copyright <a href='https://github.com/ProjSEED/lodToolkit' target='_blank'>ProjSEED</a>.");
+			writer.Member("logo", "logo.png");
+
+			writer.Key("sceneOptions");
+			writer.StartArray();
+			writer.StartObject();
+			writer.Member("navigationMode", "ORBIT");
+			writer.EndObject();
+			writer.EndArray();
+
+			writer.Key("layers");
+			writer.StartArray();
+			writer.StartObject();
+			writer.Member("type", "meshPyramid");
+			writer.Member("id", "model0");
+			writer.Member("name", "Root");
+			writer.Member("description", "Converted by ProjSEED/lodToolkit, copyright <a href='https://github.com/ProjSEED/lodToolkit' target='_blank'>ProjSEED</a>.");
+			writer.Member("SRS", srs);
+			writer.Key("SRSOrigin");
+			writer.Vec3(srsOrigin.x(), srsOrigin.y(), srsOrigin.z());
 			if (abs(offset.x()) > DBL_EPSILON || abs(offset.y()) > DBL_EPSILON || abs(offset.z()) > DBL_EPSILON)
 			{
-				oJsonLayer.AddEmptySubArray("offset");
-				oJsonLayer["offset"].Add(offset.x());
-				oJsonLayer["offset"].Add(offset.y());
-				oJsonLayer["offset"].Add(offset.z());
+				writer.Key("offset");
+				writer.Vec3(offset.x(), offset.y(), offset.z());
 			}
-			oJsonLayer.Add("root", outputDataRootRelative);
-			oJson.AddEmptySubArray("layers");
-			oJson["layers"].Add(oJsonLayer);
+			writer.Member("root", outputDataRootRelative);
+			writer.EndObject();
+			writer.EndArray();
+			writer.EndObject();
 
 			std::ofstream outfile(output);
 			if (outfile.bad())
@@ -286,7 +309,7 @@ namespace seed
 				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
 				return false;
 			}
-			outfile << oJson.ToFormattedString();
+			outfile << jsonStr;
 			if (outfile.bad())
 			{
 				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
@@ -343,10 +366,9 @@ namespace seed
 				return bb;
 			}
 
-			std::vector<CTMuint> aIndices;
-			std::vector<CTMfloat> aVertices;
-			std::vector<CTMfloat> aNormals;
-			std::vector<CTMfloat> aUVCoords;
+			// scratch of this thread, kept between calls so converting a tile does not allocate per geometry
+			thread_local std::vector<CTMuint> aIndices;
+			aIndices.clear();
 
 			// indc
 			{
@@ -362,6 +384,7 @@ namespace seed
 					}
 					idx_size += ps->getNumIndices();
 				}
+				aIndices.reserve(idx_size);
 
 				for (unsigned int k = 0; k < geometry->getNumPrimitiveSets(); k++)
 				{
@@ -428,51 +451,34 @@ namespace seed
 					}
 				}
 			}
+			// osg arrays are packed floats, openCTM reads them in place
 			osg::Array* va = geometry->getVertexArray();
 			osg::Vec3Array* v3f = (osg::Vec3Array*)va;
 			int vec_size = v3f->size();
 			for (int vidx = 0; vidx < vec_size; vidx++)
 			{
-				osg::Vec3f point = v3f->at(vidx);
-				aVertices.push_back(point.x());
-				aVertices.push_back(point.y());
-				aVertices.push_back(point.z());
-				bb.expandBy(point);
+				bb.expandBy(v3f->at(vidx));
 			}
 			// normal
-			int normal_size = 0;
+			const CTMfloat* aNormals = nullptr;
 			osg::Array* na = geometry->getNormalArray();
-			if (na)
+			if (na && na->getNumElements() == vec_size)
 			{
-				osg::Vec3Array* v3f = (osg::Vec3Array*)na;
-				normal_size = v3f->size();
-				for (int vidx = 0; vidx < normal_size; vidx++)
-				{
-					osg::Vec3f point = v3f->at(vidx);
-					aNormals.push_back(point.x());
-					aNormals.push_back(point.y());
-					aNormals.push_back(point.z());
-				}
+				aNormals = (const CTMfloat*)na->getDataPointer();
 			}
 			// texture
-			int texture_size = 0;
+			const CTMfloat* aUVCoords = nullptr;
 			osg::Array* ta = geometry->getTexCoordArray(0);
-			if (ta) {
-				osg::Vec2Array* v2f = (osg::Vec2Array*)ta;
-				texture_size = v2f->size();
-				for (int vidx = 0; vidx < texture_size; vidx++)
-				{
-					osg::Vec2f point = v2f->at(vidx);
-					aUVCoords.push_back(point.x());
-					aUVCoords.push_back(point.y());
-				}
+			if (ta && ta->getNumElements())
+			{
+				aUVCoords = (const CTMfloat*)ta->getDataPointer();
 			}
 
 			CTMexporter ctm;
-			ctm.DefineMesh(aVertices.data(), aVertices.size() / 3, aIndices.data(), aIndices.size() / 3, aNormals.data());
-			if (aUVCoords.size())
+			ctm.DefineMesh(vec_size ? (const CTMfloat*)va->getDataPointer() : nullptr, vec_size, aIndices.data(), aIndices.size() / 3, aNormals);
+			if (aUVCoords)
 			{
-				ctm.AddUVMap(aUVCoords.data(), nullptr, nullptr);
+				ctm.AddUVMap(aUVCoords, nullptr, nullptr);
 			}
 			ctm.SaveCustom(_ctm_write_buf, &bufferData);
 			return bb;
@@ -493,40 +499,26 @@ namespace seed
 				return bb;
 			}
 
-			std::vector<float> aVertices;
-			std::vector<unsigned char> aColors;
-
-			osg::Array* va = geometry->getVertexArray();
+			osg::Vec3Array* v3f = (osg::Vec3Array*)geometry->getVertexArray();
 			int vec_size = 0;
-			if (va)
+			if (v3f)
 			{
-				osg::Vec3Array* v3f = (osg::Vec3Array*)va;
 				vec_size = v3f->size();
 				for (int vidx = 0; vidx < vec_size; vidx++)
 				{
-					osg::Vec3f point = v3f->at(vidx);
-					aVertices.push_back(point.x());
-					aVertices.push_back(point.y());
-					aVertices.push_back(point.z());
-					bb.expandBy(point);
+					bb.expandBy(v3f->at(vidx));
 				}
 			}
 
-			// color
+			// color, float or normalized 8-bit
 			osg::Array* ca = geometry->getColorArray();
-			int color_size;
-			if (ca)
+			osg::Vec4Array* v4f = dynamic_cast<osg::Vec4Array*>(ca);
+			osg::Vec4ubArray* v4ub = dynamic_cast<osg::Vec4ubArray*>(ca);
+			osg::Vec3ubArray* v3ub = dynamic_cast<osg::Vec3ubArray*>(ca);
+			int color_size = 0;
+			if (v4f || v4ub || v3ub)
 			{
-				osg::Vec4Array* v4f = (osg::Vec4Array*)ca;
-				color_size = v4f->size();
-				for (int vidx = 0; vidx < color_size; vidx++)
-				{
-					osg::Vec4f point = v4f->at(vidx);
-					aColors.push_back(ColorFloatTo8Bits(point.x()));
-					aColors.push_back(ColorFloatTo8Bits(point.y()));
-					aColors.push_back(ColorFloatTo8Bits(point.z()));
-					aColors.push_back(ColorFloatTo8Bits(point.w()));
-				}
+				color_size = ca->getNumElements();
 			}
 
 			if (vec_size == 0) {
@@ -536,16 +528,221 @@ namespace seed
 				return bb;
 			}
 
-			bufferData.insert(bufferData.end(), (char*)&vec_size, (char*)&vec_size + 4);
-			bufferData.insert(bufferData.end(), (char*)aVertices.data(), (char*)aVertices.data() + sizeof(float) * aVertices.size());
-			bufferData.insert(bufferData.end(), (char*)aColors.data(), (char*)aColors.data() + sizeof(unsigned char) * aColors.size());
+			// <int32 num><float xyz * num><uint8 rgba * num>, sized once and filled in place
+			size_t offset = bufferData.size();
+			bufferData.resize(offset + 4 + vec_size * (3 * sizeof(float) + 4));
+			char* buffer = bufferData.data() + offset;
+			memcpy(buffer, &vec_size, 4);
+			memcpy(buffer + 4, v3f->getDataPointer(), vec_size * 3 * sizeof(float));
+			unsigned char* rgba = (unsigned char*)buffer + 4 + vec_size * 3 * sizeof(float);
+			if (v4f)
+			{
+				for (int vidx = 0; vidx < color_size; vidx++)
+				{
+					const osg::Vec4f& color = v4f->at(vidx);
+					rgba[4 * vidx + 0] = ColorFloatTo8Bits(color.x());
+					rgba[4 * vidx + 1] = ColorFloatTo8Bits(color.y());
+					rgba[4 * vidx + 2] = ColorFloatTo8Bits(color.z());
+					rgba[4 * vidx + 3] = ColorFloatTo8Bits(color.w());
+				}
+			}
+			else if (v4ub)
+			{
+				memcpy(rgba, v4ub->getDataPointer(), color_size * 4);
+			}
+			else
+			{
+				for (int vidx = 0; vidx < color_size; vidx++)
+				{
+					const osg::Vec3ub& color = v3ub->at(vidx);
+					rgba[4 * vidx + 0] = color.r();
+					rgba[4 * vidx + 1] = color.g();
+					rgba[4 * vidx + 2] = color.b();
+					rgba[4 * vidx + 3] = 255;
+				}
+			}
 			return bb;
 		}
 
+		// interleave the low 16 bits of x, y, z, x in the lowest bit
+		static unsigned long long MortonCode16(unsigned short x, unsigned short y, unsigned short z)
+		{
+			unsigned long long code = 0;
+			for (int i = 0; i < 16; ++i)
+			{
+				code |= (unsigned long long)((x >> i) & 1) << (3 * i);
+				code |= (unsigned long long)((y >> i) & 1) << (3 * i + 1);
+				code |= (unsigned long long)((z >> i) & 1) << (3 * i + 2);
+			}
+			return code;
+		}
+
+		bool PointCloudToQuantizedBuffer(const float* xyz, const unsigned char* rgba, int pointNum, unsigned int flags,
+			std::vector<char>& bufferData, osg::BoundingBox& bb)
+		{
+			bb.init();
+			for (int i = 0; i < pointNum; ++i)
+			{
+				bb.expandBy(osg::Vec3(xyz[3 * i + 0], xyz[3 * i + 1], xyz[3 * i + 2]));
+			}
+			if (pointNum <= 0)
+			{
+				return false;
+			}
+
+			// <uint16 qx * num><uint16 qy * num><uint16 qz * num><uint8 rgba * num>
+			std::vector<unsigned short> q(3 * (size_t)pointNum);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float extent = bb._max[axis] - bb._min[axis];
+				float scale = extent > 0 ? 65535.f / extent : 0.f;
+				for (int i = 0; i < pointNum; ++i)
+				{
+					float v = std::round((xyz[3 * i + axis] - bb._min[axis]) * scale);
+					q[(size_t)axis * pointNum + i] = (unsigned short)(v < 0 ? 0 : (v > 65535 ? 65535 : v));
+				}
+			}
+
+			std::vector<unsigned char> payload((3 * sizeof(unsigned short) + 4) * (size_t)pointNum);
+			unsigned short* qOut = (unsigned short*)payload.data();
+			unsigned char* rgbaOut = payload.data() + 3 * sizeof(unsigned short) * (size_t)pointNum;
+			if (flags & QUANTIZED_MORTON_DELTA)
+			{
+				// neighbours in morton order are close in space, their deltas are small and pack well
+				std::vector<unsigned long long> codes(pointNum);
+				for (int i = 0; i < pointNum; ++i)
+				{
+					codes[i] = MortonCode16(q[i], q[(size_t)pointNum + i], q[2 * (size_t)pointNum + i]);
+				}
+				std::vector<int> order(pointNum);
+				std::iota(order.begin(), order.end(), 0);
+				std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return codes[a] < codes[b]; });
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					const unsigned short* qAxis = q.data() + (size_t)axis * pointNum;
+					unsigned short* qOutAxis = qOut + (size_t)axis * pointNum;
+					unsigned short previous = 0;
+					for (int i = 0; i < pointNum; ++i)
+					{
+						qOutAxis[i] = (unsigned short)(qAxis[order[i]] - previous);
+						previous = qAxis[order[i]];
+					}
+				}
+				for (int i = 0; i < pointNum; ++i)
+				{
+					memcpy(rgbaOut + 4 * (size_t)i, rgba + 4 * (size_t)order[i], 4);
+				}
+			}
+			else
+			{
+				memcpy(qOut, q.data(), q.size() * sizeof(unsigned short));
+				memcpy(rgbaOut, rgba, 4 * (size_t)pointNum);
+			}
+
+			// <int32 num><uint32 flags><float bbMin * 3><float bbMax * 3><payload>, see doc/extended3mx.md
+			bufferData.clear();
+			bufferData.insert(bufferData.end(), (char*)&pointNum, (char*)&pointNum + 4);
+			bufferData.insert(bufferData.end(), (char*)&flags, (char*)&flags + 4);
+			bufferData.insert(bufferData.end(), (char*)bb._min.ptr(), (char*)bb._min.ptr() + 3 * sizeof(float));
+			bufferData.insert(bufferData.end(), (char*)bb._max.ptr(), (char*)bb._max.ptr() + 3 * sizeof(float));
+			if (flags & QUANTIZED_LZMA)
+			{
+				// <uint32 payload size><uint8 lzma props * 5><lzma stream>
+				unsigned int payloadSize = (unsigned int)payload.size();
+				size_t packedSize = 1000 + payload.size() + payload.size() / 3;
+				size_t headerSize = bufferData.size();
+				bufferData.resize(headerSize + 4 + LZMA_PROPS_SIZE + packedSize);
+				unsigned char* packed = (unsigned char*)bufferData.data() + headerSize;
+				memcpy(packed, &payloadSize, 4);
+				size_t propsSize = LZMA_PROPS_SIZE;
+				int lzmaRes = LzmaCompress(packed + 4 + LZMA_PROPS_SIZE, &packedSize, payload.data(), payload.size(),
+					packed + 4, &propsSize, 5, 0, -1, -1, -1, -1, 1, 1);
+				if (lzmaRes != SZ_OK)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Lzma compression failed with code %d", lzmaRes);
+					return false;
+				}
+				bufferData.resize(headerSize + 4 + LZMA_PROPS_SIZE + packedSize);
+			}
+			else
+			{
+				bufferData.insert(bufferData.end(), (char*)payload.data(), (char*)payload.data() + payload.size());
+			}
+			return true;
+		}
+
+		bool QuantizedBufferToPointCloud(const char* bufferData, size_t size, std::vector<float>& xyz, std::vector<unsigned char>& rgba)
+		{
+			const size_t headerSize = 8 + 6 * sizeof(float);
+			if (size < headerSize)
+			{
+				return false;
+			}
+			int pointNum;
+			unsigned int flags;
+			float bbMin[3], bbMax[3];
+			memcpy(&pointNum, bufferData, 4);
+			memcpy(&flags, bufferData + 4, 4);
+			memcpy(bbMin, bufferData + 8, 3 * sizeof(float));
+			memcpy(bbMax, bufferData + 8 + 3 * sizeof(float), 3 * sizeof(float));
+			if (pointNum < 0)
+			{
+				return false;
+			}
+
+			size_t payloadSize = (3 * sizeof(unsigned short) + 4) * (size_t)pointNum;
+			std::vector<unsigned char> unpacked;
+			const unsigned char* payload = (const unsigned char*)bufferData + headerSize;
+			if (flags & QUANTIZED_LZMA)
+			{
+				unsigned int storedSize;
+				if (size < headerSize + 4 + LZMA_PROPS_SIZE)
+				{
+					return false;
+				}
+				memcpy(&storedSize, payload, 4);
+				if (storedSize != payloadSize)
+				{
+					return false;
+				}
+				unpacked.resize(payloadSize);
+				size_t destLen = payloadSize;
+				size_t srcLen = size - headerSize - 4 - LZMA_PROPS_SIZE;
+				if (LzmaUncompress(unpacked.data(), &destLen, payload + 4 + LZMA_PROPS_SIZE, &srcLen,
+					payload + 4, LZMA_PROPS_SIZE) != SZ_OK || destLen != payloadSize)
+				{
+					return false;
+				}
+				payload = unpacked.data();
+			}
+			else if (size < headerSize + payloadSize)
+			{
+				return false;
+			}
+
+			xyz.resize(3 * (size_t)pointNum);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const unsigned char* qAxis = payload + (size_t)axis * pointNum * sizeof(unsigned short);
+				float step = (bbMax[axis] - bbMin[axis]) / 65535.f;
+				unsigned short value = 0;
+				for (int i = 0; i < pointNum; ++i)
+				{
+					unsigned short stored;
+					memcpy(&stored, qAxis + i * sizeof(unsigned short), sizeof(unsigned short));
+					value = (flags & QUANTIZED_MORTON_DELTA) ? (unsigned short)(value + stored) : stored;
+					xyz[3 * (size_t)i + axis] = bbMin[axis] + value * step;
+				}
+			}
+			const unsigned char* rgbaIn = payload + 3 * sizeof(unsigned short) * (size_t)pointNum;
+			rgba.assign(rgbaIn, rgbaIn + 4 * (size_t)pointNum);
+			return true;
+		}
+
 		void TextureToBuffer(const std::string& input, osg::Texture* texture, std::vector<char>& bufferData)
 		{
-			std::vector<unsigned char> jpeg_buf;
-			jpeg_buf.reserve(512 * 512 * 3);
+			thread_local std::vector<unsigned char> jpeg_buf;
+			jpeg_buf.clear();
 			int width, height, comp;
 			{
 				if (texture) {
@@ -614,7 +811,7 @@ namespace seed
 				texture_id_map[tex] = resTexture.id;
 				TextureToBuffer(input, tex, resTexture.bufferData);
 
-				resourcesTexture.emplace_back(resTexture);
+				resourcesTexture.emplace_back(std::move(resTexture));
 			}
 
 			// handle geometry
@@ -634,8 +831,8 @@ namespace seed
 					resGeometry.bb = GeometryTriMeshToBuffer(input, g, resGeometry.bufferData);
 					bb.expandBy(resGeometry.bb);
 
-					resourcesGeometry.emplace_back(resGeometry);
 					node.resources.push_back(resGeometry.id);
+					resourcesGeometry.emplace_back(std::move(resGeometry));
 				}
 				else if (gl_type == 1) // point-cloud
 				{
@@ -655,8 +852,8 @@ namespace seed
 					resGeometry.bb = GeometryPointCloudToBuffer(input, g, resGeometry.bufferData);
 					bb.expandBy(resGeometry.bb);
 
-					resourcesGeometry.emplace_back(resGeometry);
 					node.resources.push_back(resGeometry.id);
+					resourcesGeometry.emplace_back(std::move(resGeometry));
 				}
 			}
 			node.bb = bb;
@@ -718,13 +915,13 @@ namespace seed
 				{
 					osg::PagedLOD* lod = dynamic_cast<osg::PagedLOD*>(group->getChild(i));
 					ParsePagedLOD(input, lod, node, resourcesGeometry, resourcesTexture);
-					nodes.push_back(node);
+					nodes.push_back(std::move(node));
 				}
 				else if (group->getChild(i)->asGeode())
 				{
 					osg::Geode* geode = group->getChild(i)->asGeode();
 					ParseGeode(input, geode, node, resourcesGeometry, resourcesTexture);
-					nodes.push_back(node);
+					nodes.push_back(std::move(node));
 				}
 				else if (group->getChild(i)->asGroup())
 				{
@@ -734,7 +931,7 @@ namespace seed
 				else
 				{
 					node.maxScreenDiameter = 1e30;
-					nodes.push_back(node);
+					nodes.push_back(std::move(node));
 				}
 			}
 		}
@@ -753,7 +950,7 @@ namespace seed
 
 				ParsePagedLOD(output, lod, node, resourcesGeometry, resourcesTexture);
 
-				nodes.push_back(node);
+				nodes.push_back(std::move(node));
 			}
 			else if (osgNode->asGeode())
 			{
@@ -764,7 +961,7 @@ namespace seed
 
 				ParseGeode(output, geode, node, resourcesGeometry, resourcesTexture);
 
-				nodes.push_back(node);
+				nodes.push_back(std::move(node));
 			}
 			else if (osgNode->asGroup())
 			{
@@ -778,7 +975,7 @@ namespace seed
 
 				node.maxScreenDiameter = 1e30;
 
-				nodes.push_back(node);
+				nodes.push_back(std::move(node));
 			}
 
 			osg::BoundingBox bb;
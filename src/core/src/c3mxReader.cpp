@@ -0,0 +1,356 @@
+#include "c3mxReader.h"
+#include "cJSON.h"
+
+#include <cstring>
+#include <memory>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace seed
+{
+	namespace io
+	{
+		MappedFile::MappedFile() :
+#ifdef _WIN32
+			_file(INVALID_HANDLE_VALUE),
+			_mapping(nullptr),
+#else
+			_file(-1),
+#endif
+			_data(nullptr),
+			_size(0)
+		{
+		}
+
+		MappedFile::~MappedFile()
+		{
+			Close();
+		}
+
+		bool MappedFile::Open(const std::string& path)
+		{
+			Close();
+#ifdef _WIN32
+			_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (_file == INVALID_HANDLE_VALUE)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+			{
+				Close();
+				return false;
+			}
+			_size = (size_t)size.QuadPart;
+			_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (_mapping)
+			{
+				_data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+			}
+#else
+			_file = open(path.c_str(), O_RDONLY);
+			if (_file < 0)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			struct stat st;
+			if (fstat(_file, &st) != 0 || st.st_size == 0)
+			{
+				Close();
+				return false;
+			}
+			_size = (size_t)st.st_size;
+			void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+			_data = data == MAP_FAILED ? nullptr : (const char*)data;
+#endif
+			if (!_data)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT map file %s!", path.c_str());
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void MappedFile::Close()
+		{
+#ifdef _WIN32
+			if (_data)
+			{
+				UnmapViewOfFile(_data);
+			}
+			if (_mapping)
+			{
+				CloseHandle(_mapping);
+				_mapping = nullptr;
+			}
+			if (_file != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(_file);
+				_file = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (_data)
+			{
+				munmap((void*)_data, _size);
+			}
+			if (_file >= 0)
+			{
+				close(_file);
+				_file = -1;
+			}
+#endif
+			_data = nullptr;
+			_size = 0;
+		}
+
+		// the header is walked on the cJSON tree, the array accessors of CJsonObject copy the subtree and
+		// seek from the head of the list for every index, which is quadratic on large headers
+
+		static bool GetString(cJSON* object, const char* key, std::string& value)
+		{
+			cJSON* item = cJSON_GetObjectItem(object, key);
+			if (!item || item->type != cJSON_String)
+			{
+				return false;
+			}
+			value = item->valuestring;
+			return true;
+		}
+
+		static bool GetNumber(cJSON* object, const char* key, double& value)
+		{
+			cJSON* item = cJSON_GetObjectItem(object, key);
+			if (!item || (item->type != cJSON_Int && item->type != cJSON_Double))
+			{
+				return false;
+			}
+			value = item->valuedouble;
+			return true;
+		}
+
+		static bool GetVec3(cJSON* object, const char* key, float* xyz)
+		{
+			cJSON* item = cJSON_GetObjectItem(object, key);
+			if (!item || item->type != cJSON_Array)
+			{
+				return false;
+			}
+			int i = 0;
+			for (cJSON* value = item->child; value; value = value->next, ++i)
+			{
+				if (i == 3 || (value->type != cJSON_Int && value->type != cJSON_Double))
+				{
+					return false;
+				}
+				xyz[i] = (float)value->valuedouble;
+			}
+			return i == 3;
+		}
+
+		static void GetStrings(cJSON* object, const char* key, std::vector<std::string>& strings)
+		{
+			cJSON* item = cJSON_GetObjectItem(object, key);
+			if (!item || item->type != cJSON_Array)
+			{
+				return;
+			}
+			for (cJSON* value = item->child; value; value = value->next)
+			{
+				strings.push_back(value->type == cJSON_String ? value->valuestring : "");
+			}
+		}
+
+		bool Reader3mxb::Open(const std::string& path)
+		{
+			Close();
+			if (!_file.Open(path))
+			{
+				return false;
+			}
+			_path = path;
+			if (!Attach(_file.Data(), _file.Size()))
+			{
+				_file.Close();
+				return false;
+			}
+			return true;
+		}
+
+		bool Reader3mxb::Open(const char* data, size_t size)
+		{
+			Close();
+			return Attach(data, size);
+		}
+
+		bool Reader3mxb::Attach(const char* data, size_t size)
+		{
+			// <"3MXBO"><uint32 header length><json header><buffers>
+			if (size < 9 || memcmp(data, "3MXBO", 5) != 0)
+			{
+				seed::log::DumpLog(seed::log::Critical, "%s is NOT a 3mxb file!", _path.c_str());
+				return false;
+			}
+			memcpy(&_headerLength, data + 5, 4);
+			if (_headerLength > size - 9)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Header of %s is truncated!", _path.c_str());
+				return false;
+			}
+			_data = data;
+			_size = size;
+			_parsed.reset(new std::once_flag);
+			return true;
+		}
+
+		void Reader3mxb::Close()
+		{
+			_file.Close();
+			_data = nullptr;
+			_size = 0;
+			_headerLength = 0;
+			_path.clear();
+			_parsed.reset();
+			_valid = false;
+			_nodes.clear();
+			_resources.clear();
+		}
+
+		std::string Reader3mxb::Header() const
+		{
+			return _data ? std::string(_data + 9, _headerLength) : std::string();
+		}
+
+		const std::vector<NodeView3mx>& Reader3mxb::Nodes()
+		{
+			Valid();
+			return _nodes;
+		}
+
+		const std::vector<ResourceView3mx>& Reader3mxb::Resources()
+		{
+			Valid();
+			return _resources;
+		}
+
+		const ResourceView3mx* Reader3mxb::FindResource(const std::string& id)
+		{
+			for (const auto& resource : Resources())
+			{
+				if (resource.id == id)
+				{
+					return &resource;
+				}
+			}
+			return nullptr;
+		}
+
+		bool Reader3mxb::Valid()
+		{
+			if (!_parsed)
+			{
+				return false;
+			}
+			std::call_once(*_parsed, &Reader3mxb::ParseHeader, this);
+			return _valid;
+		}
+
+		void Reader3mxb::ParseHeader()
+		{
+			std::unique_ptr<cJSON, void(*)(cJSON*)> root(cJSON_Parse(Header().c_str()), cJSON_Delete);
+			if (!root || root->type != cJSON_Object)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Parse header of %s failed!", _path.c_str());
+				return;
+			}
+
+			cJSON* nodes = cJSON_GetObjectItem(root.get(), "nodes");
+			if (nodes && nodes->type == cJSON_Array)
+			{
+				_nodes.reserve(cJSON_GetArraySize(nodes));
+				for (cJSON* item = nodes->child; item; item = item->next)
+				{
+					_nodes.emplace_back();
+					NodeView3mx& node = _nodes.back();
+					GetString(item, "id", node.id);
+					double maxScreenDiameter = 0;
+					GetNumber(item, "maxScreenDiameter", maxScreenDiameter);
+					node.maxScreenDiameter = (float)maxScreenDiameter;
+					if (!GetVec3(item, "bbMin", node.bbMin) || !GetVec3(item, "bbMax", node.bbMax))
+					{
+						memset(node.bbMin, 0, sizeof(node.bbMin));
+						memset(node.bbMax, 0, sizeof(node.bbMax));
+					}
+					GetStrings(item, "children", node.children);
+					GetStrings(item, "resources", node.resources);
+				}
+			}
+
+			// buffers follow the header in the order of the resources
+			cJSON* resources = cJSON_GetObjectItem(root.get(), "resources");
+			size_t offset = 9 + _headerLength;
+			if (resources && resources->type == cJSON_Array)
+			{
+				_resources.reserve(cJSON_GetArraySize(resources));
+				for (cJSON* item = resources->child; item; item = item->next)
+				{
+					ResourceView3mx resource;
+					GetString(item, "type", resource.type);
+					GetString(item, "format", resource.format);
+					GetString(item, "id", resource.id);
+					GetString(item, "texture", resource.texture);
+					double pointSize = 0;
+					GetNumber(item, "pointSize", pointSize);
+					resource.pointSize = (float)pointSize;
+					if (!GetVec3(item, "bbMin", resource.bbMin) || !GetVec3(item, "bbMax", resource.bbMax))
+					{
+						memset(resource.bbMin, 0, sizeof(resource.bbMin));
+						memset(resource.bbMax, 0, sizeof(resource.bbMax));
+					}
+					cJSON* size = cJSON_GetObjectItem(item, "size");
+					uint64_t resourceSize = (size && size->type == cJSON_Int && size->valueint > 0) ? (uint64_t)size->valueint : 0;
+					if (resourceSize > _size - offset)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Resource %s of %s is truncated!", resource.id.c_str(), _path.c_str());
+						return;
+					}
+					resource.data = _data + offset;
+					resource.size = resourceSize;
+					offset += resourceSize;
+					_resources.push_back(resource);
+				}
+			}
+			_valid = true;
+		}
+
+		bool Reader3mxb::PointCloud(const ResourceView3mx& resource, PointCloudView3mx& view)
+		{
+			// <int32 num><float xyz * num><uint8 rgba * num>
+			if (resource.format != "xyz" || resource.size < 4)
+			{
+				return false;
+			}
+			memcpy(&view.pointNum, resource.data, 4);
+			if (view.pointNum < 0 || resource.size != 4 + (size_t)view.pointNum * (3 * sizeof(float) + 4))
+			{
+				return false;
+			}
+			view.xyz = resource.data + 4;
+			view.rgba = (const unsigned char*)(view.xyz + (size_t)view.pointNum * 3 * sizeof(float));
+			return true;
+		}
+	}
+}
@@ -0,0 +1,154 @@
+#include "jsonWriter.h"
+
+#include <cstdio>
+
+namespace seed
+{
+	namespace io
+	{
+		JsonWriter::JsonWriter(std::string& output, bool formatted) :
+			_output(output),
+			_formatted(formatted)
+		{
+		}
+
+		void JsonWriter::StartObject()
+		{
+			Separate();
+			_output += '{';
+			if (_formatted)
+			{
+				_output += '\n';
+			}
+			_scopes.push_back(Scope{ false, true });
+		}
+
+		void JsonWriter::EndObject()
+		{
+			if (_formatted)
+			{
+				if (!_scopes.back().empty)
+				{
+					_output += '\n';
+				}
+				Indent(_scopes.size() - 1);
+			}
+			_output += '}';
+			_scopes.pop_back();
+		}
+
+		void JsonWriter::StartArray()
+		{
+			Separate();
+			_output += '[';
+			_scopes.push_back(Scope{ true, true });
+		}
+
+		void JsonWriter::EndArray()
+		{
+			_output += ']';
+			_scopes.pop_back();
+		}
+
+		void JsonWriter::Key(const std::string& key)
+		{
+			Scope& scope = _scopes.back();
+			if (!scope.empty)
+			{
+				_output += _formatted ? ",\n" : ",";
+			}
+			scope.empty = false;
+			if (_formatted)
+			{
+				Indent(_scopes.size());
+			}
+			// no separator in an object, the value follows the key
+			String(key);
+			_output += _formatted ? ":\t" : ":";
+		}
+
+		void JsonWriter::String(const std::string& value)
+		{
+			Separate();
+			_output += '"';
+			for (unsigned char c : value)
+			{
+				switch (c)
+				{
+				case '"': _output += "\\\""; break;
+				case '\\': _output += "\\\\"; break;
+				case '\b': _output += "\\b"; break;
+				case '\f': _output += "\\f"; break;
+				case '\n': _output += "\\n"; break;
+				case '\r': _output += "\\r"; break;
+				case '\t': _output += "\\t"; break;
+				default:
+					if (c < 32)
+					{
+						char escaped[8];
+						snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+						_output += escaped;
+					}
+					else
+					{
+						_output += (char)c;
+					}
+				}
+			}
+			_output += '"';
+		}
+
+		void JsonWriter::Double(double value)
+		{
+			Separate();
+			char str[512];
+			snprintf(str, sizeof(str), "%f", value);
+			_output += str;
+		}
+
+		void JsonWriter::Int(long long value)
+		{
+			Separate();
+			_output += std::to_string(value);
+		}
+
+		void JsonWriter::Uint(unsigned long long value)
+		{
+			Separate();
+			_output += std::to_string(value);
+		}
+
+		void JsonWriter::Bool(bool value)
+		{
+			Separate();
+			_output += value ? "true" : "false";
+		}
+
+		void JsonWriter::Vec3(double x, double y, double z)
+		{
+			StartArray();
+			Double(x);
+			Double(y);
+			Double(z);
+			EndArray();
+		}
+
+		void JsonWriter::Separate()
+		{
+			if (_scopes.empty() || !_scopes.back().array)
+			{
+				return;
+			}
+			if (!_scopes.back().empty)
+			{
+				_output += _formatted ? ", " : ",";
+			}
+			_scopes.back().empty = false;
+		}
+
+		void JsonWriter::Indent(size_t depth)
+		{
+			_output.append(depth, '\t');
+		}
+	}
+}
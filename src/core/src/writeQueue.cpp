@@ -0,0 +1,102 @@
+#include "writeQueue.h"
+
+#include <algorithm>
+
+namespace seed
+{
+	namespace io
+	{
+		WriteQueue::WriteQueue(unsigned int numThreads, size_t capacity) :
+			_capacity(std::max<size_t>(capacity, 1)),
+			_running(0),
+			_stop(false),
+			_failed(false)
+		{
+			for (unsigned int i = 0; i < numThreads; ++i)
+			{
+				_threads.emplace_back(&WriteQueue::Run, this);
+			}
+		}
+
+		WriteQueue::~WriteQueue()
+		{
+			{
+				std::lock_guard<std::mutex> lck(_mutex);
+				_stop = true;
+			}
+			_conditionPop.notify_all();
+			for (auto& thread : _threads)
+			{
+				thread.join();
+			}
+		}
+
+		void WriteQueue::Push(std::function<bool()> task)
+		{
+			if (_threads.empty())
+			{
+				if (!task())
+				{
+					_failed.store(true);
+				}
+				return;
+			}
+			{
+				std::unique_lock<std::mutex> lck(_mutex);
+				_conditionPush.wait(lck, [this] { return _tasks.size() < _capacity; });
+				_tasks.push_back(std::move(task));
+			}
+			_conditionPop.notify_one();
+		}
+
+		bool WriteQueue::Flush()
+		{
+			std::unique_lock<std::mutex> lck(_mutex);
+			_conditionIdle.wait(lck, [this] { return _tasks.empty() && _running == 0; });
+			return !_failed.exchange(false);
+		}
+
+		void WriteQueue::Run()
+		{
+			while (true)
+			{
+				std::function<bool()> task;
+				{
+					std::unique_lock<std::mutex> lck(_mutex);
+					_conditionPop.wait(lck, [this] { return _stop || !_tasks.empty(); });
+					if (_tasks.empty())
+					{
+						return;
+					}
+					task = std::move(_tasks.front());
+					_tasks.pop_front();
+					++_running;
+				}
+				_conditionPush.notify_one();
+
+				bool succeed = false;
+				try
+				{
+					succeed = task();
+				}
+				catch (...)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Write task threw an exception!");
+				}
+				if (!succeed)
+				{
+					_failed.store(true);
+				}
+
+				{
+					std::lock_guard<std::mutex> lck(_mutex);
+					--_running;
+					if (_tasks.empty() && _running == 0)
+					{
+						_conditionIdle.notify_all();
+					}
+				}
+			}
+		}
+	}
+}
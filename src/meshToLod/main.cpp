@@ -5,6 +5,8 @@ void configure_parser(cli::Parser& parser) {
 	parser.set_required<std::string>("i", "input", "input file path, <obj>");
 	parser.set_required<std::string>("o", "output", "output dir path");
 	parser.set_optional<float>("r", "lodRatio", 1.f, "lod ratio, how many pixel should 1 meter have in level 0 (the most coarse level)");
+	parser.set_optional<std::string>("y", "osgbCompressor", "none", "compressor of osgb files, <none/zlib>");
+	parser.set_optional<int>("w", "writeThreads", 4, "number of threads compressing and writing osgb files, 0 to write inline");
 }
 
 int main(int argc, char** argv)
@@ -13,8 +15,16 @@ int main(int argc, char** argv)
 	configure_parser(parser);
 	parser.run_and_exit_if_error();
 
+	std::string compressor = parser.get<std::string>("y");
+	if (compressor != "none" && compressor != "zlib")
+	{
+		seed::log::DumpLog(seed::log::Critical, "Osgb compressor %s is NOT supported now.", compressor.c_str());
+		return 1;
+	}
+
 	seed::io::MeshToOSG mesh2OSG;
-	if (mesh2OSG.Convert(parser.get<std::string>("i"), parser.get<std::string>("o"), parser.get<float>("r")))
+	if (mesh2OSG.Convert(parser.get<std::string>("i"), parser.get<std::string>("o"), parser.get<float>("r"),
+		compressor == "none" ? std::string() : compressor, parser.get<int>("w")))
 	{
 		seed::log::DumpLog(seed::log::Debug, "Process succeed!");
 	}
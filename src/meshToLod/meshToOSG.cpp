@@ -1,4 +1,5 @@
 #include "meshToOSG.h"
+#include "writeQueue.h"
 
 #include <osg/BoundingBox>
 #include <osg/ref_ptr>
@@ -31,7 +32,7 @@ namespace seed
 
 		}
 
-		bool MeshToOSG::Convert(const std::string& input, const std::string& output, float lodRatio)
+		bool MeshToOSG::Convert(const std::string& input, const std::string& output, float lodRatio, const std::string& compressor, int writeThreads)
 		{
 			std::string ext = osgDB::getFileExtensionIncludingDot(input);
 			if (ext == ".obj")
@@ -68,7 +69,14 @@ namespace seed
 			osgDB::makeDirectory(dirRoot);
 			osgDB::makeDirectory(dirData);
 
-			osg::ref_ptr<osgDB::Options> pOptWrite = new osgDB::Options("WriteImageHint=IncludeFile");
+			std::string optionWrite = "WriteImageHint=IncludeFile";
+			if (!compressor.empty())
+			{
+				optionWrite += " Compressor=" + compressor;
+			}
+			osg::ref_ptr<osgDB::Options> pOptWrite = new osgDB::Options(optionWrite);
+			writeThreads = std::max(0, writeThreads);
+			WriteQueue writeQueue(writeThreads, writeThreads * 2);
 
 			osg::ref_ptr<osg::ProxyNode> pProxyNode = new osg::ProxyNode();
 			osg::BoundingBox boundingBoxGlobal;
@@ -83,7 +91,9 @@ namespace seed
 				std::string lowModelImgPath;
 				osgDB::makeDirectoryForFile(dirData + highModelRelativePath);
 				boundingBoxGlobal.expandBy(geode->getBoundingBox());
-				osgDB::writeNodeFile(*geode, dirData + highModelRelativePath, pOptWrite);
+				osg::ref_ptr<osg::Geode> geodeHigh = geode;
+				std::string highModelPath = dirData + highModelRelativePath;
+				writeQueue.Push([geodeHigh, highModelPath, pOptWrite]() { return osgDB::writeNodeFile(*geodeHigh, highModelPath, pOptWrite.get()); });
 
 				osg::Geode* geodeLow = new osg::Geode(*geode, osg::CopyOp::DEEP_COPY_ALL);
 				
@@ -116,7 +126,7 @@ namespace seed
 				}
 
 				float pixelSize = geodeLow->getBoundingBox().radius() * 2.f * lodRatio;
-				osg::PagedLOD* lod = new osg::PagedLOD;
+				osg::ref_ptr<osg::PagedLOD> lod = new osg::PagedLOD;
 				lod->setCenter(geodeLow->getBoundingBox().center());
 				lod->setRadius(geodeLow->getBoundingBox().radius());
 				lod->setRangeMode(osg::PagedLOD::PIXEL_SIZE_ON_SCREEN);
@@ -124,11 +134,21 @@ namespace seed
 				lod->setRange(1, pixelSize, 1e30);
 				lod->addChild(geodeLow);
 				lod->setFileName(1, highModelName);
-				osgDB::writeNodeFile(*lod, dirData + lowModelRelativePath, pOptWrite);
+				std::string lowModelPath = dirData + lowModelRelativePath;
+				writeQueue.Push([lod, lowModelPath, lowModelImgPath, pOptWrite]()
+				{
+					// the low image is included into the file, drop it once written
+					bool written = osgDB::writeNodeFile(*lod, lowModelPath, pOptWrite.get());
+					remove(lowModelImgPath.c_str());
+					return written;
+				});
 				pProxyNode->setFileName(i, dirDataRelative + lowModelRelativePath);
-
-				remove(lowModelImgPath.c_str());
 				seed::progress::UpdateProgress(30 + (i + 1) * 65 / group->getNumChildren());
+			}
+			if (!writeQueue.Flush())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Write node files failed!");
+				return false;
 			}
 			pProxyNode->setCenter(boundingBoxGlobal.center());
 			pProxyNode->setRadius(boundingBoxGlobal.radius());
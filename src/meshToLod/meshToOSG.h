@@ -13,7 +13,8 @@ namespace seed
 
 			~MeshToOSG();
 
-			bool Convert(const std::string& input, const std::string& output, float lodRatio);
+			// compressor of the osgb plugin, empty to write uncompressed, files are compressed and written on writeThreads threads
+			bool Convert(const std::string& input, const std::string& output, float lodRatio, const std::string& compressor, int writeThreads);
 
 		private:
 			int ExportSRS(const std::string& i_cFilePath);
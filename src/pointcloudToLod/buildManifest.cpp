@@ -0,0 +1,274 @@
+#include "buildManifest.h"
+#include "CJsonObject.hpp"
+#include "jsonWriter.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace seed
+{
+	namespace io
+	{
+		static bool GetVec3(neb::CJsonObject& oJson, const std::string& key, double* xyz)
+		{
+			if (oJson[key].GetArraySize() != 3)
+			{
+				return false;
+			}
+			for (int i = 0; i < 3; ++i)
+			{
+				if (!oJson[key].Get(i, xyz[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		static bool GetBoundingBox(neb::CJsonObject& oJson, osg::BoundingBox& box)
+		{
+			double bbMin[3], bbMax[3];
+			if (!GetVec3(oJson, "bbMin", bbMin) || !GetVec3(oJson, "bbMax", bbMax))
+			{
+				return false;
+			}
+			box.set(bbMin[0], bbMin[1], bbMin[2], bbMax[0], bbMax[1], bbMax[2]);
+			return true;
+		}
+
+		static bool GetTile(neb::CJsonObject& oTile, TileRecord& tile)
+		{
+			if (!oTile.Get("id", tile.id) || !oTile.Get("path", tile.relativePath) || !GetBoundingBox(oTile, tile.boundingBox))
+			{
+				return false;
+			}
+			uint64 firstPoint = 0, pointNum = 0;
+			oTile.Get("input", tile.input);
+			oTile.Get("firstPoint", firstPoint);
+			oTile.Get("pointNum", pointNum);
+			tile.firstPoint = firstPoint;
+			tile.pointNum = pointNum;
+			return true;
+		}
+
+		static void WriteTile(JsonWriter& writer, const TileRecord& tile)
+		{
+			writer.StartObject();
+			writer.Member("id", tile.id);
+			writer.Member("path", tile.relativePath);
+			writer.Key("bbMin");
+			writer.Vec3(tile.boundingBox.xMin(), tile.boundingBox.yMin(), tile.boundingBox.zMin());
+			writer.Key("bbMax");
+			writer.Vec3(tile.boundingBox.xMax(), tile.boundingBox.yMax(), tile.boundingBox.zMax());
+			writer.Member("input", tile.input);
+			writer.Member("firstPoint", (unsigned long long)tile.firstPoint);
+			writer.Member("pointNum", (unsigned long long)tile.pointNum);
+			writer.EndObject();
+		}
+
+		static std::string JournalPath(const std::string& filePath)
+		{
+			return filePath + ".journal";
+		}
+
+		bool BuildManifest::Load(const std::string& filePath)
+		{
+			std::ifstream infile(filePath);
+			if (!infile.good())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", filePath.c_str());
+				return false;
+			}
+			std::stringstream ss;
+			ss << infile.rdbuf();
+
+			neb::CJsonObject oJson;
+			if (!oJson.Parse(ss.str()))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Parse file %s failed!", filePath.c_str());
+				return false;
+			}
+
+			uint64 tileId = 0;
+			double xyz[3];
+			neb::CJsonObject oHistogram;
+			if (!oJson.Get("exportMode", exportMode) || !oJson.Get("colorMode", colorMode) || !oJson.Get("srs", srs)
+				|| !oJson.Get("nextTileId", tileId) || !GetVec3(oJson, "offset", xyz)
+				|| !oJson.Get("bboxZHistogram", oHistogram) || !GetBoundingBox(oHistogram, bboxZHistogram))
+			{
+				seed::log::DumpLog(seed::log::Critical, "File %s is NOT a valid manifest!", filePath.c_str());
+				return false;
+			}
+			offset.set(xyz[0], xyz[1], xyz[2]);
+			nextTileId = tileId;
+			uint64 points = 0, size = 0, pointNum = 0;
+			oJson.Get("input", input);
+			oJson.Get("inputSize", size);
+			oJson.Get("inputPointNum", pointNum);
+			oJson.Get("options", options);
+			oJson.Get("processedPoints", points);
+			refinePending = false;
+			oJson.Get("refinePending", refinePending);
+			double lonLatHeight[3], point[3];
+			hasOrigin = GetVec3(oJson, "originLonLatHeight", lonLatHeight) && GetVec3(oJson, "originPoint", point);
+			if (hasOrigin)
+			{
+				originLonLatHeight.set(lonLatHeight[0], lonLatHeight[1], lonLatHeight[2]);
+				originPoint.set(point[0], point[1], point[2]);
+			}
+			inputSize = size;
+			inputPointNum = pointNum;
+			processedPoints = points;
+
+			tiles.clear();
+			int tileNum = oJson["tiles"].GetArraySize();
+			for (int i = 0; i < tileNum; ++i)
+			{
+				TileRecord tile;
+				if (!GetTile(oJson["tiles"][i], tile))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Tile %d of %s is NOT valid!", i, filePath.c_str());
+					return false;
+				}
+				tiles.push_back(tile);
+			}
+
+			// replay the tiles journaled since the last save. a crash can cut the last line short, it is dropped and its
+			// tile written again. lines up to nextTileId are left over from a crash before the last save removed the journal
+			std::ifstream journal(JournalPath(filePath));
+			std::string line;
+			while (std::getline(journal, line))
+			{
+				neb::CJsonObject oLine;
+				uint64 lineTileId = 0, linePoints = 0;
+				if (!oLine.Parse(line) || !oLine.Get("nextTileId", lineTileId) || !oLine.Get("processedPoints", linePoints))
+				{
+					seed::log::DumpLog(seed::log::Warning, "Journal of %s ends with an incomplete line, ignored.", filePath.c_str());
+					break;
+				}
+				if (lineTileId <= nextTileId)
+				{
+					continue;
+				}
+				nextTileId = lineTileId;
+				processedPoints = linePoints;
+				neb::CJsonObject oTile;
+				TileRecord tile;
+				if (oLine.Get("tile", oTile) && GetTile(oTile, tile))
+				{
+					tiles.push_back(tile);
+				}
+			}
+			return true;
+		}
+
+		bool BuildManifest::Save(const std::string& filePath) const
+		{
+			// saved after every tile, stream it rather than append to a CJsonObject tree
+			std::string jsonStr;
+			JsonWriter writer(jsonStr, true);
+			writer.StartObject();
+			writer.Member("exportMode", exportMode);
+			writer.Member("colorMode", colorMode);
+			writer.Member("srs", srs);
+			writer.Member("nextTileId", (unsigned long long)nextTileId);
+			writer.Member("input", input);
+			writer.Member("inputSize", (unsigned long long)inputSize);
+			writer.Member("inputPointNum", (unsigned long long)inputPointNum);
+			writer.Member("options", options);
+			writer.Member("processedPoints", (unsigned long long)processedPoints);
+			writer.Member("refinePending", refinePending);
+			writer.Key("offset");
+			writer.Vec3(offset.x(), offset.y(), offset.z());
+			if (hasOrigin)
+			{
+				writer.Key("originLonLatHeight");
+				writer.Vec3(originLonLatHeight.x(), originLonLatHeight.y(), originLonLatHeight.z());
+				writer.Key("originPoint");
+				writer.Vec3(originPoint.x(), originPoint.y(), originPoint.z());
+			}
+
+			writer.Key("bboxZHistogram");
+			writer.StartObject();
+			writer.Key("bbMin");
+			writer.Vec3(bboxZHistogram.xMin(), bboxZHistogram.yMin(), bboxZHistogram.zMin());
+			writer.Key("bbMax");
+			writer.Vec3(bboxZHistogram.xMax(), bboxZHistogram.yMax(), bboxZHistogram.zMax());
+			writer.EndObject();
+
+			writer.Key("tiles");
+			writer.StartArray();
+			for (const auto& tile : tiles)
+			{
+				WriteTile(writer, tile);
+			}
+			writer.EndArray();
+			writer.EndObject();
+
+			std::string tmpFilePath = filePath + ".tmp";
+			{
+				std::ofstream outfile(tmpFilePath);
+				if (!outfile)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", tmpFilePath.c_str());
+					return false;
+				}
+				outfile << jsonStr;
+				outfile.flush();
+				if (outfile.bad())
+				{
+					seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", tmpFilePath.c_str());
+					return false;
+				}
+			}
+			std::error_code error;
+			std::filesystem::rename(tmpFilePath, filePath, error);
+			if (error)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Replace file %s failed: %s", filePath.c_str(), error.message().c_str());
+				return false;
+			}
+
+			// the journal is in the manifest now
+			std::filesystem::remove(JournalPath(filePath), error);
+			if (error)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Remove file %s failed: %s", JournalPath(filePath).c_str(), error.message().c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool BuildManifest::Journal(const std::string& filePath, const TileRecord* tile) const
+		{
+			std::string jsonStr;
+			JsonWriter writer(jsonStr);
+			writer.StartObject();
+			writer.Member("nextTileId", (unsigned long long)nextTileId);
+			writer.Member("processedPoints", (unsigned long long)processedPoints);
+			if (tile)
+			{
+				writer.Key("tile");
+				WriteTile(writer, *tile);
+			}
+			writer.EndObject();
+
+			std::string journalPath = JournalPath(filePath);
+			std::ofstream outfile(journalPath, std::ios::app);
+			if (!outfile)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", journalPath.c_str());
+				return false;
+			}
+			outfile << jsonStr << '\n';
+			outfile.flush();
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", journalPath.c_str());
+				return false;
+			}
+			return true;
+		}
+	}
+}
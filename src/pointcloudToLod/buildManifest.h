@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core.h"
+
+#include <osg/BoundingBox>
+#include <osg/Vec3d>
+
+namespace seed
+{
+	namespace io
+	{
+		// tile written by a previous run
+		struct TileRecord
+		{
+			std::string id;
+			std::string relativePath;	// relative to Data/
+			osg::BoundingBox boundingBox;
+			std::string input;			// points [firstPoint, firstPoint + pointNum) of input
+			size_t firstPoint = 0;
+			size_t pointNum = 0;
+		};
+
+		// state of an output dir, saved as <output>/manifest.json so later runs can append to it or resume it. tiles after
+		// the first of a run are appended to <output>/manifest.json.journal instead, so a run does not rewrite every tile record per tile
+		struct BuildManifest
+		{
+			std::string exportMode;
+			std::string colorMode;
+			std::string srs;
+			osg::Vec3d offset;
+			osg::BoundingBox bboxZHistogram;
+			size_t nextTileId = 0;
+			std::string input;			// input of the latest run
+			uint64_t inputSize = 0;		// bytes of input, 0 if written by an older version
+			size_t inputPointNum = 0;	// points in input, 0 if written by an older version
+			std::string options;		// options the tiles of the latest run depend on
+			size_t processedPoints = 0;	// points of input already in tiles
+			bool refinePending = false;	// a progressive run wrote the coarse levels and has not finished refining them
+			bool hasOrigin = false;		// 3d tiles placement of non geocentric input, originPoint of input lies at originLonLatHeight
+			osg::Vec3d originLonLatHeight;
+			osg::Vec3d originPoint;
+			std::vector<TileRecord> tiles;
+
+			// also replays the journal
+			bool Load(const std::string& filePath);
+
+			// write to a temporary file then replace, a crash never leaves a half written manifest. removes the journal
+			bool Save(const std::string& filePath) const;
+
+			// append nextTileId, processedPoints and tile, if not null, to the journal
+			bool Journal(const std::string& filePath, const TileRecord* tile) const;
+		};
+	}
+}
@@ -0,0 +1,196 @@
+#include "copcWriter.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace seed
+{
+	namespace io
+	{
+		// byte positions in a LAS 1.4 header followed by the copc info vlr, see the COPC specification
+		static const int64_t HEADER_SIZE = 375;
+		static const int64_t HEADER_FIRST_EVLR_POS = 235;
+		static const int64_t HEADER_EVLR_NUM_POS = 243;
+		static const int64_t VLR_HEADER_SIZE = 54;
+		static const int64_t EVLR_HEADER_SIZE = 60;
+		static const int64_t COPC_INFO_SIZE = 160;
+		static const int64_t COPC_INFO_ROOT_HIER_POS = HEADER_SIZE + VLR_HEADER_SIZE + 40;
+
+		CopcWriter::CopcWriter()
+		{
+
+		}
+
+		CopcWriter::~CopcWriter()
+		{
+			if (_laszip)
+			{
+				laszip_close_writer(_laszip);
+				laszip_destroy(_laszip);
+			}
+		}
+
+		bool CopcWriter::Open(const std::string& filePath, const osg::BoundingBox& cube, const osg::BoundingBox& boundingBox,
+			const osg::Vec3d& offset, double spacing, size_t pointNum)
+		{
+			_filePath = filePath;
+			if (laszip_create(&_laszip))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in creating laszip writer!");
+				return false;
+			}
+			laszip_header* header;
+			if (laszip_get_header_pointer(_laszip, &header))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in getting header pointer from laszip writer!");
+				return false;
+			}
+
+			// point format 7, xyz + intensity + rgb, integer coordinates in millimeters from the offset
+			header->version_major = 1;
+			header->version_minor = 4;
+			header->header_size = HEADER_SIZE;
+			header->offset_to_point_data = HEADER_SIZE;
+			header->global_encoding = 1 << 4;
+			header->point_data_format = 7;
+			header->point_data_record_length = 36;
+			strncpy(header->generating_software, "ProjSEED/lodToolkit", 32);
+			header->x_scale_factor = header->y_scale_factor = header->z_scale_factor = _scale;
+			header->x_offset = offset.x();
+			header->y_offset = offset.y();
+			header->z_offset = offset.z();
+			header->min_x = boundingBox.xMin() + offset.x();
+			header->min_y = boundingBox.yMin() + offset.y();
+			header->min_z = boundingBox.zMin() + offset.z();
+			header->max_x = boundingBox.xMax() + offset.x();
+			header->max_y = boundingBox.yMax() + offset.y();
+			header->max_z = boundingBox.zMax() + offset.z();
+			header->extended_number_of_point_records = pointNum;
+			header->extended_number_of_points_by_return[0] = pointNum;
+
+			// copc info must be the first vlr, the hierarchy position is filled in by Close
+			double info[COPC_INFO_SIZE / sizeof(double)] = { 0 };
+			osg::Vec3 center = cube.center();
+			info[0] = center.x() + offset.x();
+			info[1] = center.y() + offset.y();
+			info[2] = center.z() + offset.z();
+			info[3] = (cube.xMax() - cube.xMin()) / 2.;
+			info[4] = spacing;
+			if (laszip_add_vlr(_laszip, "copc", 1, COPC_INFO_SIZE, "copc info", (const laszip_U8*)info))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in adding copc info to laszip writer!");
+				return false;
+			}
+
+			// native las 1.4 compression, a chunk ends when a node ends
+			if (laszip_request_native_extension(_laszip, 1) || laszip_set_chunk_size(_laszip, UINT32_MAX))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in setting up laszip writer!");
+				return false;
+			}
+			_stream.open(filePath, std::ios::out | std::ios::binary);
+			if (!_stream)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", filePath.c_str());
+				return false;
+			}
+			if (laszip_open_writer_stream(_laszip, _stream, 1, 0))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in opening laszip writer for '%s'", filePath.c_str());
+				return false;
+			}
+			if (laszip_get_point_pointer(_laszip, &_point))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in getting point pointer from laszip writer!");
+				return false;
+			}
+			_chunkStart = _stream.tellp();
+			return true;
+		}
+
+		bool CopcWriter::WriteNode(int level, int x, int y, int z, const std::vector<PointCI> *pointSet,
+			const std::vector<unsigned int>& pointIndex, const osg::Vec3ub* colors)
+		{
+			if (pointIndex.empty())
+			{
+				return true;
+			}
+			_point->extended_return_number = 1;
+			_point->extended_number_of_returns = 1;
+			for (size_t i = 0; i < pointIndex.size(); ++i)
+			{
+				const PointCI& tmpPoint = pointSet->at(pointIndex[i]);
+				_point->X = (laszip_I32)std::lround(tmpPoint.P.x() / _scale);
+				_point->Y = (laszip_I32)std::lround(tmpPoint.P.y() / _scale);
+				_point->Z = (laszip_I32)std::lround(tmpPoint.P.z() / _scale);
+				_point->intensity = tmpPoint.I * 257;
+				_point->rgb[0] = colors[i].r() * 257;
+				_point->rgb[1] = colors[i].g() * 257;
+				_point->rgb[2] = colors[i].b() * 257;
+				if (laszip_write_point(_laszip))
+				{
+					seed::log::DumpLog(seed::log::Critical, "An error occured in writing point to '%s'", _filePath.c_str());
+					return false;
+				}
+			}
+			if (laszip_chunk(_laszip))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in writing chunk to '%s'", _filePath.c_str());
+				return false;
+			}
+
+			uint64_t chunkEnd = _stream.tellp();
+			Entry entry = { { level, x, y, z }, _chunkStart, (int32_t)(chunkEnd - _chunkStart), (int32_t)pointIndex.size() };
+			_entries.push_back(entry);
+			_chunkStart = chunkEnd;
+			return true;
+		}
+
+		bool CopcWriter::Close()
+		{
+			if (!_laszip)
+			{
+				return false;
+			}
+			bool closed = laszip_close_writer(_laszip) == 0;
+			laszip_destroy(_laszip);
+			_laszip = nullptr;
+			if (!closed)
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in closing laszip writer for '%s'", _filePath.c_str());
+				return false;
+			}
+
+			// hierarchy evlr after the chunk table, one page with all nodes
+			_stream.seekp(0, std::ios::end);
+			uint64_t evlrStart = _stream.tellp();
+			uint16_t reserved = 0;
+			char userId[16] = "copc";
+			uint16_t recordId = 1000;
+			uint64_t recordLength = _entries.size() * sizeof(Entry);
+			char description[32] = "copc hierarchy";
+			_stream.write((const char*)&reserved, sizeof(reserved));
+			_stream.write(userId, sizeof(userId));
+			_stream.write((const char*)&recordId, sizeof(recordId));
+			_stream.write((const char*)&recordLength, sizeof(recordLength));
+			_stream.write(description, sizeof(description));
+			_stream.write((const char*)_entries.data(), recordLength);
+
+			uint32_t evlrNum = 1;
+			uint64_t rootHier[2] = { evlrStart + EVLR_HEADER_SIZE, recordLength };
+			_stream.seekp(HEADER_FIRST_EVLR_POS);
+			_stream.write((const char*)&evlrStart, sizeof(evlrStart));
+			_stream.seekp(HEADER_EVLR_NUM_POS);
+			_stream.write((const char*)&evlrNum, sizeof(evlrNum));
+			_stream.seekp(COPC_INFO_ROOT_HIER_POS);
+			_stream.write((const char*)rootHier, sizeof(rootHier));
+			_stream.close();
+			if (_stream.fail())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", _filePath.c_str());
+				return false;
+			}
+			return true;
+		}
+	}
+}
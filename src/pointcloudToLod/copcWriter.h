@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pointCI.h"
+
+#include <fstream>
+#include <vector>
+
+#include <osg/BoundingBox>
+#include <osg/Vec3d>
+#include <osg/Vec3ub>
+
+#include "laszip_api.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// COPC, one LAZ 1.4 file with a chunk per octree node and the node keys in the hierarchy EVLR,
+		// so a node is fetched by one range read. see https://copc.io
+		class CopcWriter
+		{
+		public:
+			///////////////////////////////////////
+			// constructors and destructor
+
+			CopcWriter();
+
+			~CopcWriter();
+
+			///////////////////////////////////////
+			// public member functions
+
+			// cube is the root voxel, boundingBox the bounds of all pointNum points, both in the frame of the points,
+			// which offset moves back to the srs of the input. spacing is the point spacing of the root node
+			bool Open(const std::string& filePath, const osg::BoundingBox& cube, const osg::BoundingBox& boundingBox,
+				const osg::Vec3d& offset, double spacing, size_t pointNum);
+
+			// the points of voxel (level, x, y, z) as the next chunk
+			bool WriteNode(int level, int x, int y, int z, const std::vector<PointCI> *pointSet,
+				const std::vector<unsigned int>& pointIndex, const osg::Vec3ub* colors);
+
+			// write the hierarchy and link it from the header
+			bool Close();
+
+		private:
+			// one entry of the hierarchy page
+			struct Entry
+			{
+				int32_t key[4];
+				uint64_t offset;
+				int32_t byteSize;
+				int32_t pointCount;
+			};
+
+			std::string _filePath;
+			std::ofstream _stream;
+			laszip_POINTER _laszip = nullptr;
+			laszip_point* _point = nullptr;
+			double _scale = 0.001;
+			uint64_t _chunkStart = 0;
+			std::vector<Entry> _entries;
+		};
+	}
+}
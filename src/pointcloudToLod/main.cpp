@@ -4,13 +4,32 @@
 void configure_parser(cli::Parser& parser) {
 	parser.set_required<std::string>("i", "input", "input file path, <ply/las/laz/xyz>");
 	parser.set_required<std::string>("o", "output", "output dir path");
-	parser.set_optional<std::string>("m", "mode", "3mx", "output mode, <3mx/osgb>");
+	parser.set_optional<std::string>("m", "mode", "3mx", "output mode, <3mx/osgb/3dtiles/copc>, 3dtiles writes a tileset.json over .pnts tiles with quantized positions and rgb, copc writes each tile as one .copc.laz file");
 	parser.set_optional<float>("r", "lodRatio", 1.f, "use <1.0 value if original pointcloud is very sparse, use >1.0 value if original pointcloud is very dense");
 	parser.set_optional<int>("t", "tileSize", 1000000, "max number of point in one tile");
 	parser.set_optional<int>("n", "nodeSize", 5000, "max number of point in one node");
+	parser.set_optional<int>("z", "nodeKB", 0, "target size of one node in KB, overrides nodeSize with the point count fitting the chosen output format, 0 to disable");
+	parser.set_optional<int>("s", "minNodeSize", 0, "min number of point in one leaf node, smaller leaves are merged into their parent node, 0 to disable");
 	parser.set_optional<int>("d", "depth", 99, "max lod tree depth");
 	parser.set_optional<float>("p", "pointSize", 10.0f, "point size");
+	parser.set_optional<float>("l", "maxPointScale", 1.0f, "[osgb/3mx mode] coarse nodes draw points up to this many times the point size, by how much sparser they are than their leaves, 1 for the same point size in all nodes");
 	parser.set_optional<std::string>("c", "colorMode", "iHeightBlend", "<rgb/iGrey/iBlueWhiteRed/iHeightBlend/debug>, iGrey/iBlueWhiteRed/iHeightBlend mode use intensity from las/laz, debug mode renders each tile in different color");
+	parser.set_optional<std::string>("b", "branch", "kd", "lod tree type, <kd/quad/oct>, kd splits each node into 2 children, quad into 4 (for 2.5D aerial data), oct into 8");
+	parser.set_optional<int>("w", "writeThreads", 4, "number of threads encoding and writing node files, 0 to write inline");
+	parser.set_optional<std::string>("f", "osgbColorFormat", "float", "[osgb mode only] color array format, <float/ub4/ub3>, ub4/ub3 store normalized 8-bit colors and shrink osgb files");
+	parser.set_optional<std::string>("y", "osgbCompressor", "none", "[osgb mode only] compressor of osgb node files, <none/zlib>, compression runs on the write threads");
+	parser.set_optional<std::string>("q", "pointFormat", "xyz", "[3mx mode only] point resource format, <xyz/xyzq/xyzqLzma>, xyzq stores 16-bit quantized positions, xyzqLzma also delta codes them in morton order and compresses with lzma");
+	parser.set_optional<bool>("x", "archive", false, "[3mx mode only] write each tile into one .3mxa archive file instead of a directory of node files");
+	parser.set_optional<bool>("j", "hierarchyIndex", false, "[osgb/3mx/3dtiles mode] write <tile>.index next to the node files of each tile, listing every node with its bounds, point count, paging range and the offset and size of its file");
+	parser.set_optional<int>("k", "bundleLevels", 1, "[3mx mode only] number of tree levels packed into one 3mxb file, 1 to write one node per file");
+	parser.set_optional<bool>("a", "append", false, "add the tiles of input to an existing output dir, keeping its offset and color normalization");
+	parser.set_optional<bool>("u", "resume", false, "continue an interrupted run on the same output dir from its last completed tile, refused if the input or options changed or the run was progressive");
+	parser.set_optional<int>("g", "progressive", 0, "write the top <n> levels of all tiles and the root first so the output is viewable early, then read input again to refine, 0 to disable");
+	parser.set_optional<bool>("v", "overview", false, "build overview levels above the tiles from samples of each tile, so the root loads a bounded number of points. Without it an osgb root draws the bounding box of a tile until the tile is close enough to page in, a 3mx or 3dtiles root loads the root node of every tile in view");
+	parser.set_optional<bool>("ck", "check", false, "[3mx mode only] after the export read every node file of every tile back and decode its points, fail if a tile does not hold all of its points");
+	parser.set_optional<std::string>("og", "origin", "", "[3dtiles mode only] <lon,lat,height,x,y,z>, degrees and meters on WGS84 of the input point x,y,z, places non geocentric input on the globe as east north up meters, needed unless the input is in EPSG:4978. <lon,lat,height> is of the logged offset of the input, the center of a las/laz file or the first point of a ply/xyz file");
+	parser.set_optional<float>("sse", "screenSpaceError", 16.0f, "[3dtiles mode only] maximum screen space error of the viewer, 16 in Cesium by default, geometric errors are scaled by it so that tiles refine at the same point spacing on screen as osgb/3mx nodes page in");
+	parser.set_optional<std::string>("e", "engine", "recursive", "lod tree build engine, <recursive/morton>, morton sorts the tile by morton code once and builds nodes from code prefixes, faster on large tiles");
 }
 
 int main(int argc, char** argv)
@@ -20,10 +39,36 @@ int main(int argc, char** argv)
 	parser.run_and_exit_if_error();
 
 	seed::log::DumpLog(seed::log::Info, "Process started...");
+	seed::io::ExportOptions options;
+	options.exportMode = parser.get<std::string>("m");
+	options.tileSize = parser.get<int>("t");
+	options.maxPointNumPerOneNode = parser.get<int>("n");
+	options.nodeKB = parser.get<int>("z");
+	options.minPointNumPerOneNode = parser.get<int>("s");
+	options.maxTreeDepth = parser.get<int>("d");
+	options.lodRatio = parser.get<float>("r");
+	options.pointSize = parser.get<float>("p");
+	options.maxPointScale = parser.get<float>("l");
+	options.colorMode = parser.get<std::string>("c");
+	options.treeMode = parser.get<std::string>("b");
+	options.writeThreads = parser.get<int>("w");
+	options.osgbColorFormat = parser.get<std::string>("f");
+	options.osgbCompressor = parser.get<std::string>("y");
+	options.pointFormat = parser.get<std::string>("q");
+	options.archive = parser.get<bool>("x");
+	options.hierarchyIndex = parser.get<bool>("j");
+	options.bundleLevels = parser.get<int>("k");
+	options.append = parser.get<bool>("a");
+	options.resume = parser.get<bool>("u");
+	options.progressiveLevels = parser.get<int>("g");
+	options.overview = parser.get<bool>("v");
+	options.buildEngine = parser.get<std::string>("e");
+	options.origin = parser.get<std::string>("og");
+	options.screenSpaceError = parser.get<float>("sse");
+
 	seed::io::PointCloudToLOD pointcloudToLOD;
-	if (pointcloudToLOD.Export(parser.get<std::string>("i"), parser.get<std::string>("o"), parser.get<std::string>("m"), 
-		parser.get<int>("t"), parser.get<int>("n"), parser.get<int>("d"),
-		parser.get<float>("r"), parser.get<float>("p"), parser.get<std::string>("c")))
+	if (pointcloudToLOD.Export(parser.get<std::string>("i"), parser.get<std::string>("o"), options)
+		&& (!parser.get<bool>("ck") || seed::io::PointCloudToLOD::Check(parser.get<std::string>("o"))))
 	{
 		seed::log::DumpLog(seed::log::Info, "Process succeed!");
 	}
@@ -25,6 +25,7 @@ namespace seed
 			~PointsReader() {}
 			virtual bool Init() = 0;
 			virtual bool ReadNextPoint(PointCI& point) = 0;
+			virtual bool Seek(size_t pointId);
 			size_t GetPointsCount() { return _pointCount; }
 			size_t GetCurrentPointId() { return _currentPointId; }
 			osg::Vec3d GetOffset() { return _offset; } // set first point as offset
@@ -48,6 +49,24 @@ namespace seed
 
 		}
 
+		bool PointsReader::Seek(size_t pointId)
+		{
+			// formats without random access read up to pointId, this also sets the offset from the first point
+			if (pointId < _currentPointId)
+			{
+				return false;
+			}
+			PointCI point;
+			while (_currentPointId < pointId)
+			{
+				if (!ReadNextPoint(point))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
 		////////////////////////// Laz/Laz Reader(laszip lib can read both las or laz) /////////////////////////////////
 		class LazReader:public PointsReader
 		{
@@ -56,6 +75,7 @@ namespace seed
 			bool Init() override;
 			~LazReader();
 			bool ReadNextPoint(PointCI& point) override;
+			bool Seek(size_t pointId) override;
 
 		private:
 			osg::Vec3d _offsetCenter;
@@ -141,6 +161,17 @@ namespace seed
 			// report how many points the file has
 			seed::log::DumpLog(seed::log::Debug, "file '%s' contains %I64d points", file_name_in, _pointCount);
 
+			// init offset
+			_offsetCenter[0] = (_laszipHeader->min_x + _laszipHeader->max_x) / 2.0;
+			_offsetCenter[1] = (_laszipHeader->min_y + _laszipHeader->max_y) / 2.0;
+			_offsetCenter[2] = (_laszipHeader->min_z + _laszipHeader->max_z) / 2.0;
+
+			_offset[0] = _laszipHeader->x_offset;
+			_offset[1] = _laszipHeader->y_offset;
+			_offset[2] = _laszipHeader->z_offset;
+
+			_offset += _offsetCenter;
+
 			// get a pointer to the points that will be read
 			if (laszip_get_point_pointer(_laszipReader, &_pointRead))
 			{
@@ -162,20 +193,6 @@ namespace seed
 					return false;
 				}
 
-				// init offset
-				if (_currentPointId == 0)
-				{
-					_offsetCenter[0] = (_laszipHeader->min_x + _laszipHeader->max_x) / 2.0;
-					_offsetCenter[1] = (_laszipHeader->min_y + _laszipHeader->max_y) / 2.0;
-					_offsetCenter[2] = (_laszipHeader->min_z + _laszipHeader->max_z) / 2.0;
-
-					_offset[0] = _laszipHeader->x_offset;
-					_offset[1] = _laszipHeader->y_offset;
-					_offset[2] = _laszipHeader->z_offset;
-
-					_offset += _offsetCenter;
-				}
-
 				// add scale to coords
 				pt.P[0] = _pointRead->X * _laszipHeader->x_scale_factor - _offsetCenter[0];
 				pt.P[1] = _pointRead->Y * _laszipHeader->y_scale_factor - _offsetCenter[1];
@@ -194,6 +211,21 @@ namespace seed
 			return false;
 		}
 
+		bool LazReader::Seek(size_t pointId)
+		{
+			if (pointId > _pointCount)
+			{
+				return false;
+			}
+			if (laszip_seek_point(_laszipReader, pointId))
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error occured in seeking point %I64d", pointId);
+				return false;
+			}
+			_currentPointId = pointId;
+			return true;
+		}
+
 		////////////////////////// PLY Reader /////////////////////////////////
 		class PlyReader :public PointsReader
 		{
@@ -541,12 +573,27 @@ namespace seed
 		{
 			if (!_pointsReader->ReadNextPoint(point)) return -1;
 
+			if (_forceOffset)
+			{
+				point.P += osg::Vec3(_pointsReader->GetOffset() - _offset);
+			}
 			return 1;
 		}
 
+		bool PointVisitor::Seek(size_t pointId)
+		{
+			return _pointsReader->Seek(pointId);
+		}
+
 		osg::Vec3d PointVisitor::GetOffset()
 		{
-			return _pointsReader->GetOffset();
+			return _forceOffset ? _offset : _pointsReader->GetOffset();
+		}
+
+		void PointVisitor::SetOffset(const osg::Vec3d& offset)
+		{
+			_forceOffset = true;
+			_offset = offset;
 		}
 	}
 }
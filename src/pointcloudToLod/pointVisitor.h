@@ -14,8 +14,10 @@ namespace seed
 			bool PerpareFile(const std::string& input, bool runStatistic);
 
 			int NextPoint(PointCI& point);	// >= 1 normal, 0 end, -1 error
+			bool Seek(size_t pointId);		// next point read is pointId
 
 			osg::Vec3d GetOffset();
+			void SetOffset(const osg::Vec3d& offset);	// shift points into the frame of a previous run
 			osg::BoundingBox GetBBox() { return _bbox; }
 			osg::BoundingBox GetBBoxZHistogram() { return _bboxZHistogram; }
 			
@@ -28,6 +30,8 @@ namespace seed
 			std::shared_ptr<PointsReader> _pointsReader;
 			osg::BoundingBox _bbox;
 			osg::BoundingBox _bboxZHistogram;
+			bool _forceOffset = false;
+			osg::Vec3d _offset;
 		};
 	}
 }
@@ -1,13 +1,31 @@
 #include "pointcloudToLod.h"
 #include "tileToLod.h"
 #include "c3mx.h"
+#include "buildManifest.h"
 
 #include <osgDB/FileNameUtils>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
 
 namespace seed
 {
 	namespace io
 	{
+		std::string ExportOptions::TileOptions() const
+		{
+			return "tileSize=" + std::to_string(tileSize) + " nodeSize=" + std::to_string(maxPointNumPerOneNode)
+				+ " minNodeSize=" + std::to_string(minPointNumPerOneNode) + " depth=" + std::to_string(maxTreeDepth)
+				+ " lodRatio=" + std::to_string(lodRatio) + " pointSize=" + std::to_string(pointSize) + " maxPointScale=" + std::to_string(maxPointScale)
+				+ " colorMode=" + colorMode + " branch=" + treeMode + " engine=" + buildEngine
+				+ " osgbColorFormat=" + osgbColorFormat + " osgbCompressor=" + osgbCompressor + " pointFormat=" + pointFormat
+				+ " bundleLevels=" + std::to_string(bundleLevels) + " archive=" + std::to_string(archive)
+				+ " hierarchyIndex=" + std::to_string(hierarchyIndex) + " overview=" + std::to_string(overview)
+				+ " progressive=" + std::to_string(progressiveLevels) + " origin=" + origin + " screenSpaceError=" + std::to_string(screenSpaceError);
+		}
 
 		PointCloudToLOD::PointCloudToLOD()
 		{
@@ -19,65 +37,404 @@ namespace seed
 
 		}
 
-		bool PointCloudToLOD::Export(const std::string& input, const std::string& output, const std::string& exportMode,
-			int tileSize, int maxPointNumPerOneNode, int maxTreeDepth,
-			float lodRatio, float pointSize, std::string colorMode)
+		bool PointCloudToLOD::Export(const std::string& input, const std::string& output, ExportOptions options)
 		{
 			// check export mode
 			ExportMode eExportMode;
-			if (exportMode == "osgb")
+			if (options.exportMode == "osgb")
 			{
 				eExportMode = ExportMode::OSGB;
 			}
-			else if (exportMode == "3mx")
+			else if (options.exportMode == "3mx")
 			{
 				eExportMode = ExportMode::_3MX;
 			}
+			else if (options.exportMode == "3dtiles")
+			{
+				eExportMode = ExportMode::_3DTILES;
+			}
+			else if (options.exportMode == "copc")
+			{
+				eExportMode = ExportMode::COPC;
+			}
 			else
 			{
-				seed::log::DumpLog(seed::log::Critical, "Mode %s is NOT support!", exportMode.c_str());
+				seed::log::DumpLog(seed::log::Critical, "Mode %s is NOT support!", options.exportMode.c_str());
 				return false;
 			}
-			seed::log::DumpLog(seed::log::Info, "Export mode: %s", exportMode.c_str());
+			seed::log::DumpLog(seed::log::Info, "Export mode: %s", options.exportMode.c_str());
 
 			// check color mode
 			ColorMode eColorMode;
-			if (colorMode == "debug")
+			if (options.colorMode == "debug")
 			{
 				eColorMode = ColorMode::Debug;
 			}
-			else if (colorMode == "rgb")
+			else if (options.colorMode == "rgb")
 			{
 				eColorMode = ColorMode::RGB;
 			}
-			else if (colorMode == "iGrey")
+			else if (options.colorMode == "iGrey")
 			{
 				eColorMode = ColorMode::IntensityGrey;
 			}
-			else if (colorMode == "iBlueWhiteRed")
+			else if (options.colorMode == "iBlueWhiteRed")
 			{
 				eColorMode = ColorMode::IntensityBlueWhiteRed;
 			}
-			else if (colorMode == "iHeightBlend")
+			else if (options.colorMode == "iHeightBlend")
 			{
 				eColorMode = ColorMode::IntensityHeightBlend;
 			}
 			else
 			{
-				seed::log::DumpLog(seed::log::Critical, "ColorMode %s is NOT supported now.", colorMode.c_str());
+				seed::log::DumpLog(seed::log::Critical, "ColorMode %s is NOT supported now.", options.colorMode.c_str());
+				return false;
+			}
+			seed::log::DumpLog(seed::log::Info, "Color mode: %s", options.colorMode.c_str());
+
+			// check tree mode
+			TreeMode eTreeMode;
+			if (options.treeMode == "kd")
+			{
+				eTreeMode = TreeMode::KdTree;
+			}
+			else if (options.treeMode == "quad")
+			{
+				eTreeMode = TreeMode::QuadTree;
+			}
+			else if (options.treeMode == "oct")
+			{
+				eTreeMode = TreeMode::Octree;
+			}
+			else
+			{
+				seed::log::DumpLog(seed::log::Critical, "Tree mode %s is NOT supported now.", options.treeMode.c_str());
+				return false;
+			}
+			if (eExportMode == ExportMode::COPC && eTreeMode != TreeMode::Octree)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Copc mode needs an octree, tree mode %s ignored.", options.treeMode.c_str());
+				eTreeMode = TreeMode::Octree;
+				options.treeMode = "oct";
+			}
+			seed::log::DumpLog(seed::log::Info, "Tree mode: %s", options.treeMode.c_str());
+
+			// check build engine
+			BuildEngine eBuildEngine;
+			if (options.buildEngine == "recursive")
+			{
+				eBuildEngine = BuildEngine::Recursive;
+			}
+			else if (options.buildEngine == "morton")
+			{
+				eBuildEngine = BuildEngine::Morton;
+			}
+			else
+			{
+				seed::log::DumpLog(seed::log::Critical, "Build engine %s is NOT supported now.", options.buildEngine.c_str());
 				return false;
 			}
-			seed::log::DumpLog(seed::log::Info, "Color mode: %s", colorMode.c_str());
+			seed::log::DumpLog(seed::log::Info, "Build engine: %s", options.buildEngine.c_str());
+
+			// check osgb color format
+			ColorFormat eColorFormat;
+			if (options.osgbColorFormat == "float")
+			{
+				eColorFormat = ColorFormat::Float4;
+			}
+			else if (options.osgbColorFormat == "ub4")
+			{
+				eColorFormat = ColorFormat::UByte4;
+			}
+			else if (options.osgbColorFormat == "ub3")
+			{
+				eColorFormat = ColorFormat::UByte3;
+			}
+			else
+			{
+				seed::log::DumpLog(seed::log::Critical, "Osgb color format %s is NOT supported now.", options.osgbColorFormat.c_str());
+				return false;
+			}
+			if (eExportMode == ExportMode::OSGB)
+			{
+				seed::log::DumpLog(seed::log::Info, "Osgb color format: %s", options.osgbColorFormat.c_str());
+			}
+
+			// check osgb compressor, zlib is the one compressor the osgb plugin ships with
+			if (options.osgbCompressor != "none" && options.osgbCompressor != "zlib")
+			{
+				seed::log::DumpLog(seed::log::Critical, "Osgb compressor %s is NOT supported now.", options.osgbCompressor.c_str());
+				return false;
+			}
+			if (eExportMode == ExportMode::OSGB)
+			{
+				seed::log::DumpLog(seed::log::Info, "Osgb compressor: %s", options.osgbCompressor.c_str());
+			}
+			if (options.osgbCompressor == "none")
+			{
+				options.osgbCompressor.clear();
+			}
+
+			// check point scale, coarse nodes never draw smaller points than the leaves
+			if (options.maxPointScale < 1.f)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Max point scale %f is less than 1, use 1.", options.maxPointScale);
+				options.maxPointScale = 1.f;
+			}
+			if (eExportMode == ExportMode::OSGB || eExportMode == ExportMode::_3MX)
+			{
+				seed::log::DumpLog(seed::log::Info, "Max point scale: %f", options.maxPointScale);
+			}
+
+			// check 3mx point format
+			PointFormat ePointFormat;
+			if (options.pointFormat == "xyz")
+			{
+				ePointFormat = PointFormat::Xyz;
+			}
+			else if (options.pointFormat == "xyzq")
+			{
+				ePointFormat = PointFormat::Xyzq;
+			}
+			else if (options.pointFormat == "xyzqLzma")
+			{
+				ePointFormat = PointFormat::XyzqLzma;
+			}
+			else
+			{
+				seed::log::DumpLog(seed::log::Critical, "Point format %s is NOT supported now.", options.pointFormat.c_str());
+				return false;
+			}
+			if (eExportMode == ExportMode::_3MX)
+			{
+				seed::log::DumpLog(seed::log::Info, "Point format: %s", options.pointFormat.c_str());
+			}
+
+			// check archive
+			if (options.archive && eExportMode != ExportMode::_3MX)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Archive is only supported in 3mx mode, ignored.");
+				options.archive = false;
+			}
+
+			// check node size, a target size per node overrides the point count
+			if (options.nodeKB > 0)
+			{
+				options.maxPointNumPerOneNode = std::max(1, int(options.nodeKB * 1024LL / TileToLOD::BytesPerPoint(eExportMode, eColorFormat, ePointFormat)));
+				seed::log::DumpLog(seed::log::Info, "Node size: %d KB, %d points", options.nodeKB, options.maxPointNumPerOneNode);
+			}
+
+			// check bundle levels
+			options.bundleLevels = std::max(1, options.bundleLevels);
+			if (options.bundleLevels > 1 && eExportMode != ExportMode::_3MX)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Bundle levels is only supported in 3mx mode, ignored.");
+				options.bundleLevels = 1;
+			}
+			seed::log::DumpLog(seed::log::Info, "Bundle levels: %d", options.bundleLevels);
+
+			// check copc, each tile is written as one file in one go
+			if (eExportMode == ExportMode::COPC && options.progressiveLevels > 0)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Progressive is NOT supported in copc mode, ignored.");
+				options.progressiveLevels = 0;
+			}
+			if (eExportMode == ExportMode::COPC && options.overview)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Overview is NOT supported in copc mode, ignored.");
+				options.overview = false;
+			}
+			if (options.progressiveLevels > 0)
+			{
+				seed::log::DumpLog(seed::log::Info, "Progressive coarse levels: %d", options.progressiveLevels);
+			}
+			if (eExportMode == ExportMode::COPC && options.hierarchyIndex)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Hierarchy index is NOT supported in copc mode, the copc hierarchy is used instead, ignored.");
+				options.hierarchyIndex = false;
+			}
+
+			// check origin, <lon,lat,height> places the offset of the input on the globe, <lon,lat,height,x,y,z> the input point x,y,z
+			std::vector<double> originValues;
+			if (!options.origin.empty() && eExportMode != ExportMode::_3DTILES)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Origin is only supported in 3dtiles mode, ignored.");
+				options.origin.clear();
+			}
+			if (!options.origin.empty())
+			{
+				std::stringstream ss(options.origin);
+				std::string value;
+				while (std::getline(ss, value, ','))
+				{
+					char* end = nullptr;
+					originValues.push_back(std::strtod(value.c_str(), &end));
+					if (end == value.c_str())
+					{
+						originValues.clear();
+						break;
+					}
+				}
+				if ((originValues.size() != 3 && originValues.size() != 6) || std::abs(originValues[1]) > 90.)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Origin %s is NOT <lon,lat,height> or <lon,lat,height,x,y,z>!", options.origin.c_str());
+					return false;
+				}
+				seed::log::DumpLog(seed::log::Info, "Origin: %s", options.origin.c_str());
+			}
+
+			// check screen space error
+			if (eExportMode == ExportMode::_3DTILES)
+			{
+				if (options.screenSpaceError <= 0)
+				{
+					seed::log::DumpLog(seed::log::Warning, "Screen space error %f is NOT valid, use 16.", options.screenSpaceError);
+					options.screenSpaceError = 16.f;
+				}
+				seed::log::DumpLog(seed::log::Info, "Screen space error: %f", options.screenSpaceError);
+			}
+
+			// options the tiles depend on, a resumed run must go on with the same ones
+			std::string tileOptions = options.TileOptions();
+
+			// check append and resume, new tiles share offset and color normalization with the existing output
+			std::string manifestPath = output + "/manifest.json";
+			BuildManifest manifest;
+			size_t processedPoints = 0;
+			if (options.resume && !osgDB::fileExists(manifestPath))
+			{
+				seed::log::DumpLog(seed::log::Warning, "Nothing to resume in %s, start from beginning.", output.c_str());
+				options.resume = false;
+			}
+			if (options.resume && options.progressiveLevels > 0)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Resume is NOT supported in progressive mode!");
+				return false;
+			}
+			bool continueOutput = options.append || options.resume;
+			if (continueOutput)
+			{
+				if (!manifest.Load(manifestPath))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Append or resume needs the output of a previous run in %s!", output.c_str());
+					return false;
+				}
+				if (manifest.exportMode != options.exportMode)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Mode %s does NOT match existing output in mode %s!", options.exportMode.c_str(), manifest.exportMode.c_str());
+					return false;
+				}
+				if (manifest.colorMode != options.colorMode)
+				{
+					seed::log::DumpLog(seed::log::Warning, "Color mode %s differs from existing output in color mode %s.", options.colorMode.c_str(), manifest.colorMode.c_str());
+				}
+				if (originValues.size())
+				{
+					osg::Vec3d lonLatHeight(originValues[0], originValues[1], originValues[2]);
+					osg::Vec3d point = originValues.size() == 6 ? osg::Vec3d(originValues[3], originValues[4], originValues[5]) : manifest.offset;
+					// the manifest keeps 6 decimals
+					if (manifest.hasOrigin && ((manifest.originLonLatHeight - lonLatHeight).length() > 1e-5 || (manifest.originPoint - point).length() > 1e-5))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Origin %s does NOT match the origin of existing output!", options.origin.c_str());
+						return false;
+					}
+					manifest.hasOrigin = true;
+					manifest.originLonLatHeight = lonLatHeight;
+					manifest.originPoint = point;
+				}
+				if (manifest.refinePending)
+				{
+					if (options.resume)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Output in %s is of an interrupted progressive run, it can NOT be resumed, run it again!", output.c_str());
+						return false;
+					}
+					seed::log::DumpLog(seed::log::Warning, "Output in %s is of an interrupted progressive run, its tiles keep only the coarse levels.", output.c_str());
+				}
+				if (options.resume)
+				{
+					if (manifest.input != input)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Input %s does NOT match input %s of the run to resume!", input.c_str(), manifest.input.c_str());
+						return false;
+					}
+					if (manifest.options.empty())
+					{
+						seed::log::DumpLog(seed::log::Warning, "Manifest records no options, can NOT check them against the run to resume.");
+					}
+					else if (manifest.options != tileOptions)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Options \"%s\" do NOT match options \"%s\" of the run to resume!", tileOptions.c_str(), manifest.options.c_str());
+						return false;
+					}
+					processedPoints = manifest.processedPoints;
+					seed::log::DumpLog(seed::log::Info, "Resume from point %I64d", (long long)processedPoints);
+				}
+				seed::log::DumpLog(seed::log::Info, "Append to %d existing tiles", (int)manifest.tiles.size());
+			}
+			else
+			{
+				// a stale journal must not be resumed into this run
+				if (osgDB::fileExists(manifestPath) && std::remove(manifestPath.c_str()) != 0)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Remove file %s failed!", manifestPath.c_str());
+					return false;
+				}
+				manifest.exportMode = options.exportMode;
+				manifest.colorMode = options.colorMode;
+				if (originValues.size())
+				{
+					// a 3 value origin is completed by the offset, known after the first tile
+					manifest.hasOrigin = true;
+					manifest.originLonLatHeight.set(originValues[0], originValues[1], originValues[2]);
+					if (originValues.size() == 6)
+					{
+						manifest.originPoint.set(originValues[3], originValues[4], originValues[5]);
+					}
+				}
+			}
 
 			// check input
 			std::shared_ptr<PointVisitor> pointVisitor = std::shared_ptr<PointVisitor>(new PointVisitor);
-			if (!pointVisitor->PerpareFile(input, eColorMode == ColorMode::IntensityHeightBlend))
+			if (!pointVisitor->PerpareFile(input, eColorMode == ColorMode::IntensityHeightBlend && !continueOutput))
 			{
-				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s", input);
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s", input.c_str());
 				return false;
 			}
+			std::error_code error;
+			uint64_t inputSize = std::filesystem::file_size(input, error);
+			size_t inputPointNum = pointVisitor->GetNumOfPoints();
+			if (options.resume)
+			{
+				if (manifest.inputPointNum == 0)
+				{
+					seed::log::DumpLog(seed::log::Warning, "Manifest records no input size, can NOT check %s against the run to resume.", input.c_str());
+				}
+				else if (manifest.inputSize != inputSize || manifest.inputPointNum != inputPointNum)
+				{
+					seed::log::DumpLog(seed::log::Critical, "%s has changed since the run to resume, %I64d bytes %I64d points now, %I64d bytes %I64d points before!", input.c_str(),
+						(long long)inputSize, (long long)inputPointNum, (long long)manifest.inputSize, (long long)manifest.inputPointNum);
+					return false;
+				}
+			}
+			osg::BoundingBox bboxZHistogram = pointVisitor->GetBBoxZHistogram();
+			if (continueOutput)
+			{
+				pointVisitor->SetOffset(manifest.offset);
+				bboxZHistogram = manifest.bboxZHistogram;
+				if (pointVisitor->GetSRSName() != manifest.srs)
+				{
+					seed::log::DumpLog(seed::log::Warning, "SRS of %s differs from existing output, keep the existing one.", input.c_str());
+				}
+			}
 			std::string ext = osgDB::getFileExtensionIncludingDot(input);
 			seed::log::DumpLog(seed::log::Info, "Input file format: %s", ext.c_str());
+			if (processedPoints && !pointVisitor->Seek(processedPoints))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Seek to point %I64d of %s failed!", (long long)processedPoints, input.c_str());
+				return false;
+			}
 
 			// check output
 			if (osgDB::makeDirectory(output) == false)
@@ -93,57 +450,423 @@ namespace seed
 			}
 
 			// convert
+			options.writeThreads = std::max(0, options.writeThreads);
+			std::shared_ptr<WriteQueue> writeQueue = std::shared_ptr<WriteQueue>(new WriteQueue(options.writeThreads, options.writeThreads * 4));
+			seed::log::DumpLog(seed::log::Info, "Write threads: %d", options.writeThreads);
+
 			std::vector<PointCI> lstPoints;
-			lstPoints.reserve(tileSize);
+			lstPoints.reserve(options.tileSize);
 
-			int processedPoints = 0;
-			size_t tileID = 0;
-			std::vector<std::string> tileIds;
-			std::vector<std::string> tileRelativePaths;
-			std::vector<osg::BoundingBox> tileBBoxes;
-			seed::progress::UpdateProgress(0, true);
-			while (this->LoadPointsForOneTile(pointVisitor, lstPoints, tileSize, processedPoints))
+			std::shared_ptr<TileToLOD> overviewGenerator;
+			if (options.overview)
+			{
+				overviewGenerator.reset(new TileToLOD(options.maxTreeDepth, options.maxPointNumPerOneNode, 0, options.lodRatio, options.pointSize, bboxZHistogram, eColorMode, eTreeMode, eColorFormat, 1, eBuildEngine, ProgressivePhase::Full, 0, writeQueue));
+				overviewGenerator->SetPointFormat(ePointFormat);
+				overviewGenerator->SetOsgbCompressor(options.osgbCompressor);
+				overviewGenerator->SetScreenSpaceError(options.screenSpaceError);
+			}
+
+			size_t tileID = manifest.nextTileId;
+			size_t firstTileID = tileID;
+			size_t firstPoint = processedPoints;
+			manifest.input = input;
+			manifest.inputSize = inputSize;
+			manifest.inputPointNum = inputPointNum;
+			manifest.options = tileOptions;
+			manifest.processedPoints = processedPoints;
+			manifest.refinePending = options.progressiveLevels > 0;
+			bool manifestSaved = false;
+			int passNum = options.progressiveLevels > 0 ? 2 : 1;
+			for (int pass = 0; pass < passNum; ++pass)
 			{
-				TileToLOD lodGenerator(maxTreeDepth, maxPointNumPerOneNode, lodRatio, pointSize, pointVisitor->GetBBoxZHistogram(), eColorMode);
-				std::string tileName = "Tile_" + std::to_string(tileID++);
-				std::string tilePath = filePathData + "/" + tileName;
-				if (osgDB::makeDirectory(tilePath) == false)
+				ProgressivePhase phase = (passNum == 1) ? ProgressivePhase::Full : (pass == 0 ? ProgressivePhase::Coarse : ProgressivePhase::Refine);
+				if (phase == ProgressivePhase::Refine)
 				{
-					seed::log::DumpLog(seed::log::Critical, "Make directory %s failed!", tilePath.c_str());
-					return false;
+					// coarse levels are viewable from here, read input again for the deeper levels
+					if (!ExportRoot(manifest, output, eExportMode, overviewGenerator.get(), options.lodRatio, options.maxPointNumPerOneNode, options.archive))
+					{
+						return false;
+					}
+					seed::log::DumpLog(seed::log::Info, "Coarse levels finished, refine");
+					pointVisitor.reset(new PointVisitor);
+					if (!pointVisitor->PerpareFile(input, false))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s", input.c_str());
+						return false;
+					}
+					pointVisitor->SetOffset(manifest.offset);
+					if (firstPoint && !pointVisitor->Seek(firstPoint))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Seek to point %I64d of %s failed!", (long long)firstPoint, input.c_str());
+						return false;
+					}
+					tileID = firstTileID;
+					processedPoints = firstPoint;
 				}
 
-				osg::BoundingBox box;
-				if (!lodGenerator.Generate(&lstPoints, tilePath, tileName, eExportMode, box))
+				seed::progress::UpdateProgress(processedPoints * 100LL / pointVisitor->GetNumOfPoints(), true);
+				while (this->LoadPointsForOneTile(pointVisitor, lstPoints, options.tileSize, processedPoints))
 				{
-					seed::log::DumpLog(seed::log::Critical, "Generate point tiles %s failed!", tilePath.c_str());
-					return false;
+					TileToLOD lodGenerator(options.maxTreeDepth, options.maxPointNumPerOneNode, std::max(0, options.minPointNumPerOneNode), options.lodRatio, options.pointSize, bboxZHistogram, eColorMode, eTreeMode, eColorFormat, options.bundleLevels, eBuildEngine, phase, std::max(0, options.progressiveLevels), writeQueue);
+					lodGenerator.SetColorSeed(tileID);
+					lodGenerator.SetPointFormat(ePointFormat);
+					lodGenerator.SetOffset(pointVisitor->GetOffset());
+					lodGenerator.SetOsgbCompressor(options.osgbCompressor);
+					lodGenerator.SetHierarchyIndex(options.hierarchyIndex);
+					lodGenerator.SetMaxPointScale(options.maxPointScale);
+					lodGenerator.SetScreenSpaceError(options.screenSpaceError);
+					std::string tileName = "Tile_" + std::to_string(tileID++);
+					std::string tilePath = filePathData + "/" + tileName;
+					std::shared_ptr<ArchiveWriter> tileArchive;
+					if (eExportMode == ExportMode::COPC)
+					{
+						// one file, no node files
+						tilePath += ".copc.laz";
+					}
+					else if (options.archive)
+					{
+						// one archive per tile instead of a directory, refine appends to the coarse one
+						tilePath += ".3mxa";
+						tileArchive = std::make_shared<ArchiveWriter>();
+						if (!tileArchive->Open(tilePath, phase == ProgressivePhase::Refine))
+						{
+							return false;
+						}
+						lodGenerator.SetArchive(tileArchive);
+					}
+					else if (osgDB::makeDirectory(tilePath) == false)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Make directory %s failed!", tilePath.c_str());
+						return false;
+					}
+
+					osg::BoundingBox box;
+					std::vector<PointCI> samples;
+					bool writeSamples = options.overview && phase != ProgressivePhase::Refine;
+					if (!lodGenerator.Generate(&lstPoints, tilePath, tileName, eExportMode, box, writeSamples ? &samples : nullptr))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Generate point tiles %s failed!", tilePath.c_str());
+						return false;
+					}
+
+					// without origin the tileset keeps the input coordinates, they must be geocentric EPSG:4978, on the surface
+					// of the earth between the polar and equatorial radius up to a few km. fail on the first tile, not after all of them
+					double earthCenterDistance = (osg::Vec3d(box.center()) + pointVisitor->GetOffset()).length();
+					if (eExportMode == ExportMode::_3DTILES && !manifest.hasOrigin && box.valid() && (earthCenterDistance < 6.3e6 || earthCenterDistance > 6.4e6))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Tile %s is %.0f m from the earth center, the input is NOT in geocentric EPSG:4978 and Cesium would draw it there. "
+							"Set --origin to the longitude, latitude and height of the input to place it on the globe!", tileName.c_str(), earthCenterDistance);
+						return false;
+					}
+					if (writeSamples && !SaveSamples(samples, tilePath + "/" + tileName + ".samples", tileArchive.get()))
+					{
+						return false;
+					}
+
+					std::string topLevelNodeRelativePath;
+					if (eExportMode == ExportMode::OSGB)
+					{
+						topLevelNodeRelativePath = tileName + "/" + tileName + ".osgb";
+					}
+					else if (eExportMode == ExportMode::_3MX)
+					{
+						topLevelNodeRelativePath = tileName + (options.archive ? ".3mxa/" : "/") + tileName + ".3mxb";
+					}
+					else if (eExportMode == ExportMode::_3DTILES)
+					{
+						topLevelNodeRelativePath = tileName + "/tileset.json";
+					}
+					else if (eExportMode == ExportMode::COPC)
+					{
+						topLevelNodeRelativePath = tileName + ".copc.laz";
+					}
+					else
+					{
+						seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", eExportMode);
+						return false;
+					}
+
+					// wait for writer threads, the tile is journaled only once all its files are on disk
+					if (!writeQueue->Flush())
+					{
+						seed::log::DumpLog(seed::log::Critical, "Write node files failed!");
+						return false;
+					}
+					if (phase == ProgressivePhase::Refine)
+					{
+						// deeper levels are on disk, now replace the coarse files linking to them
+						lodGenerator.CommitDeferredWrites();
+						if (!writeQueue->Flush() || (options.hierarchyIndex && !lodGenerator.SaveHierarchyIndex(tilePath, tileName)) || (tileArchive && !tileArchive->Close()))
+						{
+							seed::log::DumpLog(seed::log::Critical, "Write node files failed!");
+							return false;
+						}
+						processedPoints += lstPoints.size();
+						seed::progress::UpdateProgress(processedPoints * 100LL / pointVisitor->GetNumOfPoints());
+						continue;
+					}
+					if (options.hierarchyIndex && !lodGenerator.SaveHierarchyIndex(tilePath, tileName))
+					{
+						return false;
+					}
+					bool topLevelNodeExists = tileArchive ? tileArchive->Contains(tileName + ".3mxb") : osgDB::fileExists(filePathData + "/" + topLevelNodeRelativePath);
+					if (tileArchive && !tileArchive->Close())
+					{
+						return false;
+					}
+					const TileRecord* newTile = nullptr;
+					if (topLevelNodeExists)
+					{
+						TileRecord tile;
+						tile.id = tileName;
+						tile.relativePath = topLevelNodeRelativePath;
+						tile.boundingBox = box;
+						tile.input = input;
+						tile.firstPoint = processedPoints;
+						tile.pointNum = lstPoints.size();
+						manifest.tiles.push_back(tile);
+						newTile = &manifest.tiles.back();
+					}
+					processedPoints += lstPoints.size();
+
+					// journal, the first tile of the run saves the whole manifest with the state of this run
+					if (!continueOutput)
+					{
+						manifest.srs = pointVisitor->GetSRSName();
+						manifest.offset = pointVisitor->GetOffset();
+						if (originValues.size() == 3)
+						{
+							manifest.originPoint = manifest.offset;
+						}
+						manifest.bboxZHistogram = bboxZHistogram;
+					}
+					manifest.nextTileId = tileID;
+					manifest.processedPoints = processedPoints;
+					if (!(manifestSaved ? manifest.Journal(manifestPath, newTile) : manifest.Save(manifestPath)))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", manifestPath.c_str());
+						return false;
+					}
+					manifestSaved = true;
+
+					seed::progress::UpdateProgress(processedPoints * 100LL / pointVisitor->GetNumOfPoints());
+				}
+			}
+			// fold the journal into the manifest
+			manifest.refinePending = false;
+			if (!manifest.Save(manifestPath))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", manifestPath.c_str());
+				return false;
+			}
+
+			if (!ExportRoot(manifest, output, eExportMode, overviewGenerator.get(), options.lodRatio, options.maxPointNumPerOneNode, options.archive))
+			{
+				return false;
+			}
+
+			seed::progress::UpdateProgress(100);
+			return true;
+		}
+
+		osg::ref_ptr<osg::Node> PointCloudToLOD::MakeRootGroup(const std::vector<std::string>& fileNames, const std::vector<osg::BoundingBox>& boundingBoxes,
+			const std::vector<float>& ranges, std::vector<unsigned int>& ids)
+		{
+			// groups of at most maxChildNum paged tiles, split at the median tile center along the longest axis,
+			// so opening the root reads no tile and culling skips whole groups
+			const unsigned int maxChildNum = 8;
+			osg::ref_ptr<osg::Group> group = new osg::Group;
+			if (ids.size() <= maxChildNum)
+			{
+				for (auto id : ids)
+				{
+					osg::ref_ptr<osg::PagedLOD> pagedLOD = new osg::PagedLOD;
+					pagedLOD->setRangeMode(osg::PagedLOD::PIXEL_SIZE_ON_SCREEN);
+					unsigned int fileChild = 0;
+					if (ranges[id] > 0)
+					{
+						pagedLOD->addChild(MakeBoundingBoxProxy(boundingBoxes[id]).get(), 0, ranges[id]);
+						pagedLOD->setNumChildrenThatCannotBeExpired(1);
+						fileChild = 1;
+					}
+					pagedLOD->setFileName(fileChild, fileNames[id]);
+					pagedLOD->setRange(fileChild, ranges[id], FLT_MAX);
+					pagedLOD->setCenter(boundingBoxes[id].center());
+					pagedLOD->setRadius(boundingBoxes[id].radius());
+					group->addChild(pagedLOD.get());
+				}
+				return group;
+			}
+
+			osg::BoundingBox boundingBoxCenters;
+			for (auto id : ids)
+			{
+				boundingBoxCenters.expandBy(boundingBoxes[id].center());
+			}
+			osg::Vec3 extents = boundingBoxCenters._max - boundingBoxCenters._min;
+			int axis = (extents.x() >= extents.y() && extents.x() >= extents.z()) ? 0 : (extents.y() >= extents.z() ? 1 : 2);
+			std::vector<unsigned int>::iterator median = ids.begin() + ids.size() / 2;
+			std::nth_element(ids.begin(), median, ids.end(), [&](unsigned int a, unsigned int b)
+			{
+				return boundingBoxes[a].center()[axis] < boundingBoxes[b].center()[axis];
+			});
+			std::vector<unsigned int> idsLeft(ids.begin(), median);
+			std::vector<unsigned int> idsRight(median, ids.end());
+			group->addChild(MakeRootGroup(fileNames, boundingBoxes, ranges, idsLeft).get());
+			group->addChild(MakeRootGroup(fileNames, boundingBoxes, ranges, idsRight).get());
+			return group;
+		}
+
+		osg::ref_ptr<osg::Node> PointCloudToLOD::MakeBoundingBoxProxy(const osg::BoundingBox& boundingBox)
+		{
+			// 12 edges, nothing to page in and a few bytes in the root
+			osg::ref_ptr<osg::Vec3Array> vertexArray = new osg::Vec3Array(8);
+			for (unsigned int i = 0; i < 8; ++i)
+			{
+				(*vertexArray)[i] = boundingBox.corner(i);
+			}
+			osg::ref_ptr<osg::DrawElementsUShort> edges = new osg::DrawElementsUShort(osg::PrimitiveSet::LINES);
+			const unsigned short corners[24] = { 0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7 };
+			edges->insert(edges->end(), corners, corners + 24);
+			osg::ref_ptr<osg::Vec4Array> colorArray = new osg::Vec4Array(1);
+			(*colorArray)[0] = osg::Vec4(0.5f, 0.5f, 0.5f, 1.f);
+
+			osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+			geometry->setVertexArray(vertexArray.get());
+			geometry->setColorArray(colorArray.get());
+			geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+			geometry->addPrimitiveSet(edges.get());
+			geometry->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+			osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+			geode->addDrawable(geometry.get());
+			return geode;
+		}
+
+		Tile3dtiles PointCloudToLOD::MakeRootTile(const std::vector<std::string>& contents, const std::vector<osg::BoundingBox>& boundingBoxes,
+			const std::vector<double>& errors, std::vector<unsigned int>& ids)
+		{
+			// same grouping as MakeRootGroup, a group refines as soon as one of its tiles would show
+			const unsigned int maxChildNum = 8;
+			Tile3dtiles group;
+			for (auto id : ids)
+			{
+				group.bb.expandBy(boundingBoxes[id]);
+				group.geometricError = std::max(group.geometricError, errors[id]);
+			}
+			if (ids.size() <= maxChildNum)
+			{
+				for (auto id : ids)
+				{
+					Tile3dtiles tile;
+					tile.bb = boundingBoxes[id];
+					tile.geometricError = errors[id];
+					tile.content = contents[id];
+					group.children.push_back(tile);
 				}
+				return group;
+			}
+
+			osg::BoundingBox boundingBoxCenters;
+			for (auto id : ids)
+			{
+				boundingBoxCenters.expandBy(boundingBoxes[id].center());
+			}
+			osg::Vec3 extents = boundingBoxCenters._max - boundingBoxCenters._min;
+			int axis = (extents.x() >= extents.y() && extents.x() >= extents.z()) ? 0 : (extents.y() >= extents.z() ? 1 : 2);
+			std::vector<unsigned int>::iterator median = ids.begin() + ids.size() / 2;
+			std::nth_element(ids.begin(), median, ids.end(), [&](unsigned int a, unsigned int b)
+			{
+				return boundingBoxes[a].center()[axis] < boundingBoxes[b].center()[axis];
+			});
+			std::vector<unsigned int> idsLeft(ids.begin(), median);
+			std::vector<unsigned int> idsRight(median, ids.end());
+			group.children.push_back(MakeRootTile(contents, boundingBoxes, errors, idsLeft));
+			group.children.push_back(MakeRootTile(contents, boundingBoxes, errors, idsRight));
+			return group;
+		}
+
+		bool PointCloudToLOD::ExportRoot(const BuildManifest& manifest, const std::string& output, ExportMode eExportMode, TileToLOD* overviewGenerator,
+			double lodRatio, unsigned int maxPointNumPerOneNode, bool archive)
+		{
+			// root covers the tiles of all runs
+			std::vector<std::string> tileIds;
+			std::vector<std::string> tileRelativePaths;
+			std::vector<osg::BoundingBox> tileBBoxes;
+			std::vector<float> tileRanges;
+			std::vector<double> tileErrors;
+			for (const auto& tile : manifest.tiles)
+			{
+				tileIds.push_back(tile.id);
+				tileRelativePaths.push_back(tile.relativePath);
+				tileBBoxes.push_back(tile.boundingBox);
+
+				// osgb pages a tile in once its root points would be lodRatio pixels apart on screen and draws its box
+				// until then, so the root costs the same however many tiles are in view. 3d tiles and 3mx have no such
+				// placeholder, their tiles show as soon as they are in view. the overview replaces all of this
+				float extents[3] = { tile.boundingBox.xMax() - tile.boundingBox.xMin(), tile.boundingBox.yMax() - tile.boundingBox.yMin(), tile.boundingBox.zMax() - tile.boundingBox.zMin() };
+				std::sort(extents, extents + 3);
+				size_t rootPointNum = tile.pointNum ? std::min<size_t>(tile.pointNum, maxPointNumPerOneNode) : maxPointNumPerOneNode;
+				double spacing = std::sqrt(extents[2] * std::max(extents[1], extents[2] / rootPointNum) / rootPointNum);
+				tileRanges.push_back(spacing > 0 ? lodRatio * tile.boundingBox.radius() * 2. / spacing : 0.);
+				tileErrors.push_back(tile.boundingBox.radius() * 2.);
+			}
 
-				std::string topLevelNodeRelativePath;
-				if (eExportMode == ExportMode::OSGB)
+			// or only the overview pyramid, which links to the tiles
+			if (overviewGenerator && manifest.tiles.size())
+			{
+				std::vector<PointCI> samples;
+				std::vector<std::vector<unsigned int>> tileSamples;
+				std::vector<NodeChild> tiles;
+				for (const auto& tile : manifest.tiles)
 				{
-					topLevelNodeRelativePath = tileName + "/" + tileName + ".osgb";
+					NodeChild child;
+					child.fileName = "../" + tile.relativePath;
+					child.boundingBox = tile.boundingBox;
+					tiles.push_back(child);
+
+					std::vector<PointCI> tileSample;
+					std::string samplePath = output + "/Data/" + osgDB::getFilePath(tile.relativePath) + "/" + tile.id + ".samples";
+					if (!LoadSamples(tileSample, samplePath))
+					{
+						seed::log::DumpLog(seed::log::Warning, "Tile %s has no samples for overview.", tile.id.c_str());
+					}
+					tileSamples.push_back(std::vector<unsigned int>(tileSample.size()));
+					std::iota(tileSamples.back().begin(), tileSamples.back().end(), (unsigned int)samples.size());
+					samples.insert(samples.end(), tileSample.begin(), tileSample.end());
 				}
-				else if (eExportMode == ExportMode::_3MX)
+
+				std::string overviewName = "Overview";
+				std::string overviewPath = output + "/Data/" + overviewName;
+				std::shared_ptr<ArchiveWriter> overviewArchive;
+				if (archive)
 				{
-					topLevelNodeRelativePath = tileName + "/" + tileName + ".3mxb";
+					overviewPath += ".3mxa";
+					overviewArchive = std::make_shared<ArchiveWriter>();
+					if (!overviewArchive->Open(overviewPath, false))
+					{
+						return false;
+					}
 				}
-				else
+				else if (osgDB::makeDirectory(overviewPath) == false)
 				{
-					seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", eExportMode);
+					seed::log::DumpLog(seed::log::Critical, "Make directory %s failed!", overviewPath.c_str());
 					return false;
 				}
-
-				if (osgDB::fileExists(filePathData + "/" + topLevelNodeRelativePath))
+				osg::BoundingBox boundingBoxOverview;
+				overviewGenerator->SetArchive(overviewArchive);
+				bool overviewGenerated = overviewGenerator->GenerateOverview(&samples, tiles, tileSamples, overviewPath, overviewName, eExportMode, boundingBoxOverview);
+				overviewGenerator->SetArchive(nullptr);
+				if (!overviewGenerated || (overviewArchive && !overviewArchive->Close()))
 				{
-					tileIds.push_back(tileName);
-					tileRelativePaths.push_back(topLevelNodeRelativePath);
-					tileBBoxes.push_back(box);
+					seed::log::DumpLog(seed::log::Critical, "Generate overview %s failed!", overviewPath.c_str());
+					return false;
 				}
-
-				processedPoints += lstPoints.size();
-				seed::progress::UpdateProgress((size_t)processedPoints * 100LL / pointVisitor->GetNumOfPoints());
+				std::string overviewFileName = (eExportMode == ExportMode::_3DTILES) ? "tileset.json" : overviewName + TileToLOD::NodeFileFormat(eExportMode);
+				tileIds = { overviewName };
+				tileRelativePaths = { overviewName + (archive ? ".3mxa/" : "/") + overviewFileName };
+				tileBBoxes = { boundingBoxOverview };
+				tileRanges = { 0.f };
+				tileErrors = { boundingBoxOverview.radius() * 2. };
 			}
 
 			// export root and metadata
@@ -152,22 +875,25 @@ namespace seed
 				std::string outputRoot = output + "/Root.osgb";
 				std::string outputMetadata = output + "/metadata.xml";
 				osg::ref_ptr<osg::MatrixTransform> pRoot = new osg::MatrixTransform();
-				auto l_oOffset = pointVisitor->GetOffset();
+				auto l_oOffset = manifest.offset;
 				pRoot->setMatrix(osg::Matrix::translate(l_oOffset.x(), l_oOffset.y(), l_oOffset.z()));
-				osg::ProxyNode* pProxyNode = new osg::ProxyNode();
-				pProxyNode->setCenter(pointVisitor->GetBBox().center());
-				pProxyNode->setRadius(pointVisitor->GetBBox().radius());
-				pProxyNode->setLoadingExternalReferenceMode(osg::ProxyNode::LOAD_IMMEDIATELY);
-				for (int i = 0; i < tileRelativePaths.size(); i++) {
-					pProxyNode->setFileName(i, "./Data/" + tileRelativePaths[i]);
-				}
-				pRoot->addChild(pProxyNode);
+				std::vector<std::string> tileFileNames;
+				for (const auto& tileRelativePath : tileRelativePaths)
+				{
+					tileFileNames.push_back("./Data/" + tileRelativePath);
+				}
+				std::vector<unsigned int> ids(tileFileNames.size());
+				std::iota(ids.begin(), ids.end(), 0);
+				if (ids.size())
+				{
+					pRoot->addChild(MakeRootGroup(tileFileNames, tileBBoxes, tileRanges, ids));
+				}
 				osg::ref_ptr<osgDB::Options> pOpt = new osgDB::Options("precision=15");
 				if (osgDB::writeNodeFile(*pRoot, outputRoot, pOpt) == false)
 				{
 					seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", outputRoot.c_str());
 				}
-				if (!ExportSRS(pointVisitor->GetSRSName(), outputMetadata))
+				if (!ExportSRS(manifest.srs, outputMetadata))
 				{
 					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputMetadata.c_str());
 					return false;
@@ -189,19 +915,138 @@ namespace seed
 					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputMetadata.c_str());
 					return false;
 				}
-				if (!Generate3mx(pointVisitor->GetSRSName(), osg::Vec3d(0, 0, 0), pointVisitor->GetOffset(), outputDataRootRelative, output3mx))
+				if (!Generate3mx(manifest.srs, osg::Vec3d(0, 0, 0), manifest.offset, outputDataRootRelative, output3mx))
 				{
 					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", output3mx.c_str());
 					return false;
 				}
 			}
+			else if (eExportMode == ExportMode::_3DTILES)
+			{
+				// positions stay in the srs of the input, offset by the root transform. with an origin the root transform is the
+				// east north up frame at the origin, input coordinates are taken as meters east, north and up of originPoint
+				std::string outputTileset = output + "/tileset.json";
+				std::string outputMetadata = output + "/metadata.xml";
+				std::vector<std::string> tileContents;
+				for (const auto& tileRelativePath : tileRelativePaths)
+				{
+					tileContents.push_back("Data/" + tileRelativePath);
+				}
+				std::vector<unsigned int> ids(tileContents.size());
+				std::iota(ids.begin(), ids.end(), 0);
+				Tile3dtiles root;
+				if (ids.size())
+				{
+					root = MakeRootTile(tileContents, tileBBoxes, tileErrors, ids);
+				}
+				bool tilesetGenerated = false;
+				if (manifest.hasOrigin)
+				{
+					seed::log::DumpLog(seed::log::Info, "Origin: input point %f, %f, %f at %f, %f, %f", manifest.originPoint.x(), manifest.originPoint.y(), manifest.originPoint.z(),
+						manifest.originLonLatHeight.x(), manifest.originLonLatHeight.y(), manifest.originLonLatHeight.z());
+					double transform[16];
+					EastNorthUpToEcef(manifest.originLonLatHeight.x(), manifest.originLonLatHeight.y(), manifest.originLonLatHeight.z(), transform);
+					osg::Vec3d shift = manifest.offset - manifest.originPoint;
+					for (int i = 0; i < 3; ++i)
+					{
+						transform[12 + i] += transform[i] * shift.x() + transform[4 + i] * shift.y() + transform[8 + i] * shift.z();
+					}
+					tilesetGenerated = GenerateTileset(root, transform, outputTileset);
+				}
+				else
+				{
+					tilesetGenerated = GenerateTileset(root, manifest.offset, outputTileset);
+				}
+				if (!tilesetGenerated)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputTileset.c_str());
+					return false;
+				}
+				if (!ExportSRS(manifest.srs, outputMetadata))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputMetadata.c_str());
+					return false;
+				}
+			}
+			else if (eExportMode == ExportMode::COPC)
+			{
+				// the tiles are complete files in Data, only the srs is left
+				std::string outputMetadata = output + "/metadata.xml";
+				if (!ExportSRS(manifest.srs, outputMetadata))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputMetadata.c_str());
+					return false;
+				}
+			}
 			else
 			{
 				seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", eExportMode);
 				return false;
 			}
+			return true;
+		}
 
-			seed::progress::UpdateProgress(100);
+		bool PointCloudToLOD::SaveSamples(const std::vector<PointCI>& samples, const std::string& filePath, ArchiveWriter* archive)
+		{
+			unsigned int sampleNum = samples.size();
+			if (archive)
+			{
+				std::vector<char> buffer(sizeof(sampleNum) + sizeof(PointCI) * samples.size());
+				memcpy(buffer.data(), &sampleNum, sizeof(sampleNum));
+				memcpy(buffer.data() + sizeof(sampleNum), samples.data(), sizeof(PointCI) * samples.size());
+				return archive->Append(osgDB::getSimpleFileName(filePath), buffer.data(), buffer.size());
+			}
+
+			std::ofstream outfile(filePath, std::ios::binary);
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", filePath.c_str());
+				return false;
+			}
+			outfile.write((const char*)&sampleNum, sizeof(sampleNum));
+			outfile.write((const char*)samples.data(), sizeof(PointCI) * samples.size());
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", filePath.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool PointCloudToLOD::LoadSamples(std::vector<PointCI>& samples, const std::string& filePath)
+		{
+			std::string archivePath, name;
+			if (ArchiveReader::SplitPath(filePath, archivePath, name))
+			{
+				ArchiveReader archive;
+				std::vector<char> buffer;
+				unsigned int sampleNum = 0;
+				if (!archive.Open(archivePath) || !archive.Read(name, buffer) || buffer.size() < sizeof(sampleNum))
+				{
+					return false;
+				}
+				memcpy(&sampleNum, buffer.data(), sizeof(sampleNum));
+				if (buffer.size() != sizeof(sampleNum) + sizeof(PointCI) * sampleNum)
+				{
+					return false;
+				}
+				samples.resize(sampleNum);
+				memcpy(samples.data(), buffer.data() + sizeof(sampleNum), sizeof(PointCI) * sampleNum);
+				return true;
+			}
+
+			std::ifstream infile(filePath, std::ios::binary);
+			unsigned int sampleNum = 0;
+			if (!infile.read((char*)&sampleNum, sizeof(sampleNum)))
+			{
+				return false;
+			}
+			samples.resize(sampleNum);
+			if (!infile.read((char*)samples.data(), sizeof(PointCI) * samples.size()))
+			{
+				samples.clear();
+				return false;
+			}
 			return true;
 		}
 
@@ -244,6 +1089,122 @@ namespace seed
 			}
 		}
 
+		bool PointCloudToLOD::Check(const std::string& output)
+		{
+			BuildManifest manifest;
+			if (!manifest.Load(output + "/manifest.json"))
+			{
+				return false;
+			}
+			if (manifest.exportMode != "3mx")
+			{
+				seed::log::DumpLog(seed::log::Critical, "Check is only supported in 3mx mode!");
+				return false;
+			}
+
+			bool ok = true;
+			for (const auto& tile : manifest.tiles)
+			{
+				long long pointNum = 0;
+				std::string filePath = output + "/Data/" + tile.relativePath;
+				std::string archivePath, name;
+				if (ArchiveReader::SplitPath(filePath, archivePath, name))
+				{
+					ArchiveReader archive;
+					if (!archive.Open(archivePath))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", archivePath.c_str());
+						return false;
+					}
+					std::vector<char> buffer;
+					for (const auto& entry : archive.Names())
+					{
+						if (osgDB::getFileExtensionIncludingDot(entry) != ".3mxb")
+						{
+							continue;
+						}
+						Reader3mxb reader;
+						long long nodePointNum = -1;
+						if (archive.Read(entry, buffer) && reader.Open(buffer.data(), buffer.size()))
+						{
+							nodePointNum = CountPoints(reader, entry);
+						}
+						if (nodePointNum < 0)
+						{
+							seed::log::DumpLog(seed::log::Critical, "Node %s of %s is broken!", entry.c_str(), archivePath.c_str());
+							pointNum = -1;
+							break;
+						}
+						pointNum += nodePointNum;
+					}
+				}
+				else
+				{
+					std::error_code error;
+					for (const auto& entry : std::filesystem::directory_iterator(osgDB::getFilePath(filePath), error))
+					{
+						if (entry.path().extension() != ".3mxb")
+						{
+							continue;
+						}
+						std::string nodePath = entry.path().string();
+						Reader3mxb reader;
+						long long nodePointNum = reader.Open(nodePath) ? CountPoints(reader, nodePath) : -1;
+						if (nodePointNum < 0)
+						{
+							seed::log::DumpLog(seed::log::Critical, "Node %s is broken!", nodePath.c_str());
+							pointNum = -1;
+							break;
+						}
+						pointNum += nodePointNum;
+					}
+				}
+				if (pointNum != (long long)tile.pointNum)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Tile %s holds %I64d points, %I64d expected!", tile.id.c_str(), pointNum, (long long)tile.pointNum);
+					ok = false;
+				}
+			}
+			if (ok)
+			{
+				seed::log::DumpLog(seed::log::Info, "Checked %d tiles", (int)manifest.tiles.size());
+			}
+			return ok;
+		}
+
+		long long PointCloudToLOD::CountPoints(Reader3mxb& reader, const std::string& fileName)
+		{
+			if (!reader.Valid())
+			{
+				return -1;
+			}
+			long long pointNum = 0;
+			std::vector<float> xyz;
+			std::vector<unsigned char> rgba;
+			for (const auto& resource : reader.Resources())
+			{
+				if (resource.format == "xyz")
+				{
+					PointCloudView3mx view;
+					if (!Reader3mxb::PointCloud(resource, view))
+					{
+						return -1;
+					}
+					pointNum += view.pointNum;
+				}
+				else if (resource.format == "xyzq")
+				{
+					if (!QuantizedBufferToPointCloud(resource.data, resource.size, xyz, rgba))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Decode resource %s of %s failed!", resource.id.c_str(), fileName.c_str());
+						return -1;
+					}
+					pointNum += xyz.size() / 3;
+				}
+			}
+			return pointNum;
+		}
+
 		bool PointCloudToLOD::ExportSRS(const std::string& srs, const std::string& filePath)
 		{
 			std::ofstream outfile(filePath);
@@ -1,11 +1,47 @@
 #pragma once
 
 #include "pointVisitor.h"
+#include "tileToLod.h"
+#include "buildManifest.h"
+#include "c3mxReader.h"
 
 namespace seed
 {
 	namespace io
 	{
+		// options of an export, see main.cpp for what each of them does
+		struct ExportOptions
+		{
+			std::string exportMode = "3mx";
+			int tileSize = 1000000;
+			int maxPointNumPerOneNode = 5000;
+			int nodeKB = 0;
+			int minPointNumPerOneNode = 0;
+			int maxTreeDepth = 99;
+			float lodRatio = 1.f;
+			float pointSize = 10.f;
+			float maxPointScale = 1.f;
+			std::string colorMode = "iHeightBlend";
+			std::string treeMode = "kd";
+			int writeThreads = 4;
+			std::string osgbColorFormat = "float";
+			std::string osgbCompressor = "none";
+			std::string pointFormat = "xyz";
+			bool archive = false;
+			bool hierarchyIndex = false;
+			int bundleLevels = 1;
+			bool append = false;
+			bool resume = false;
+			int progressiveLevels = 0;
+			bool overview = false;
+			std::string buildEngine = "recursive";
+			std::string origin;			// [3dtiles] <lon,lat,height> or <lon,lat,height,x,y,z>
+			float screenSpaceError = 16.f;
+
+			// options the tiles depend on, as saved in the manifest. a resumed run must go on with the same ones
+			std::string TileOptions() const;
+		};
+
 		class PointCloudToLOD
 		{
 		public:
@@ -19,9 +55,12 @@ namespace seed
 			///////////////////////////////////////
 			// public member functions
 
-			bool Export(const std::string& input, const std::string& output, const std::string& exportMode,
-				int tileSize, int maxPointNumPerOneNode, int maxTreeDepth,
-				float lodRatio, float pointSize, std::string colorMode);
+			// options is taken by value, unsupported combinations are adjusted in it before they are used
+			bool Export(const std::string& input, const std::string& output, ExportOptions options);
+
+			// read every 3mxb node of every tile in a 3mx output dir back and decode its points, false if a tile
+			// does not hold the points the manifest records for it
+			static bool Check(const std::string& output);
 
 		private:
 			///////////////////////////////////////
@@ -30,7 +69,30 @@ namespace seed
 			static bool LoadPointsForOneTile(std::shared_ptr<PointVisitor> pointVisitor,
 				std::vector<PointCI>& lstPoints, size_t tileSize, size_t processedPoints);
 
+			// overviewGenerator, if not null, builds an overview pyramid over the tiles for the root to link to
+			static bool ExportRoot(const BuildManifest& manifest, const std::string& output, ExportMode eExportMode, TileToLOD* overviewGenerator,
+				double lodRatio, unsigned int maxPointNumPerOneNode, bool archive);
+
+			// osgb root, a hierarchy of groups paging the tiles in on demand. a tile with a range above 0 draws its
+			// bounding box until it is paged in
+			static osg::ref_ptr<osg::Node> MakeRootGroup(const std::vector<std::string>& fileNames, const std::vector<osg::BoundingBox>& boundingBoxes,
+				const std::vector<float>& ranges, std::vector<unsigned int>& ids);
+
+			static osg::ref_ptr<osg::Node> MakeBoundingBoxProxy(const osg::BoundingBox& boundingBox);
+
+			// 3d tiles root, the same hierarchy with the tile tilesets as contents
+			static Tile3dtiles MakeRootTile(const std::vector<std::string>& contents, const std::vector<osg::BoundingBox>& boundingBoxes,
+				const std::vector<double>& errors, std::vector<unsigned int>& ids);
+
+			// representative points of a tile, kept next to the tile for the overview
+			static bool SaveSamples(const std::vector<PointCI>& samples, const std::string& filePath, ArchiveWriter* archive);
+
+			static bool LoadSamples(std::vector<PointCI>& samples, const std::string& filePath);
+
 			static bool ExportSRS(const std::string& srs, const std::string& filePath);
+
+			// points of the "xyz" and "xyzq" resources of a 3mxb, -1 if it is broken
+			static long long CountPoints(Reader3mxb& reader, const std::string& fileName);
 		};
 
 	};
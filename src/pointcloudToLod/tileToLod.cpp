@@ -1,18 +1,32 @@
 #include "tileToLOD.h"
 #include "c3mx.h"
+#include "copcWriter.h"
 #include <random>
 #include <chrono>
+#include <array>
+#include <numeric>
+#include <thread>
+#include <filesystem>
+#include <osgDB/FileNameUtils>
 
 namespace seed
 {
 	namespace io
 	{
+		static unsigned char ColorFloatTo8Bits(float colorFloat)
+		{
+			int val = colorFloat * 255.f;
+			if (val < 0) return 0;
+			if (val > 255) return 255;
+			return static_cast<unsigned char>(val);
+		};
+
 		void TileToLOD::CreateColorBar()
 		{
 			std::vector<osg::Vec4> steps;
 			if (_colorMode == ColorMode::Debug)
 			{
-				std::random_device e;
+				std::mt19937 e(_colorSeed);
 				std::uniform_real_distribution<double> randomDist(0, 1);
 				osg::Vec4 random(randomDist(e), randomDist(e), randomDist(e), 1.);
 				steps.push_back(random);
@@ -65,6 +79,52 @@ namespace seed
 					float lower = 1. - upper;
 					_colorBar[i] = steps[floor] * lower + steps[floor + 1] * upper;
 				}
+				_colorBar8Bits[i].set(ColorFloatTo8Bits(_colorBar[i].r()), ColorFloatTo8Bits(_colorBar[i].g()),
+					ColorFloatTo8Bits(_colorBar[i].b()), ColorFloatTo8Bits(_colorBar[i].a()));
+				_colorBar8BitsRGB[i].set(_colorBar8Bits[i].r(), _colorBar8Bits[i].g(), _colorBar8Bits[i].b());
+			}
+		}
+
+		unsigned int TileToLOD::BytesPerPoint(ExportMode exportMode, ColorFormat colorFormat, PointFormat pointFormat)
+		{
+			if (exportMode == ExportMode::_3MX)
+			{
+				// xyz or xyzq resource, see MakeNode3mx. lzma output size depends on the data, size by the uncompressed payload
+				return pointFormat == PointFormat::Xyz ? 3 * sizeof(float) + 4 : 3 * sizeof(unsigned short) + 4;
+			}
+			if (exportMode == ExportMode::_3DTILES)
+			{
+				// POSITION_QUANTIZED + RGB, see GeneratePnts
+				return 3 * sizeof(unsigned short) + 3;
+			}
+			if (exportMode == ExportMode::COPC)
+			{
+				// point format 7 record, laz output size depends on the data, size by the uncompressed record
+				return 36;
+			}
+			switch (colorFormat)
+			{
+			case ColorFormat::UByte4:
+				return sizeof(osg::Vec3) + sizeof(osg::Vec4ub);
+			case ColorFormat::UByte3:
+				return sizeof(osg::Vec3) + sizeof(osg::Vec3ub);
+			default:
+				return sizeof(osg::Vec3) + sizeof(osg::Vec4);
+			}
+		}
+
+		std::string TileToLOD::NodeFileFormat(ExportMode exportMode)
+		{
+			switch (exportMode)
+			{
+			case ExportMode::OSGB:
+				return ".osgb";
+			case ExportMode::_3MX:
+				return ".3mxb";
+			case ExportMode::_3DTILES:
+				return ".pnts";
+			default:
+				return "";
 			}
 		}
 
@@ -118,285 +178,1378 @@ namespace seed
 			return maxAxisInfo;
 		}
 
-		bool TileToLOD::Generate(const std::vector<PointCI> *pointSet,
-			const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, osg::BoundingBox& boundingBoxLevel0)
+		unsigned int TileToLOD::SplitBoundingBox(const osg::BoundingBox& boundingBox, std::vector<int>& splitAxes, std::vector<osg::BoundingBox>& childBoundingBoxes)
 		{
-			std::vector<unsigned int> pointIndex;
-			osg::BoundingBox boundingBox;
-			for (int i = 0; i < pointSet->size(); i++)
+			splitAxes.clear();
+			if (_treeMode == TreeMode::Octree)
 			{
-				pointIndex.push_back(i);
-				boundingBox.expandBy(pointSet->at(i).P);
+				splitAxes = { X, Y, Z };
 			}
-			boundingBoxLevel0 = boundingBox;
-			try
+			else if (_treeMode == TreeMode::QuadTree)
 			{
-				BuildNode(pointSet, pointIndex, boundingBox, boundingBox, saveFilePath, strBlock, 0, 0, exportMode);
-				pointIndex.swap(std::vector<unsigned int>());
+				splitAxes = { X, Y };
 			}
-			catch (...)
+			else
 			{
-				seed::log::DumpLog(seed::log::Critical, "KDTree generate error!");
-				return false;
+				osg::BoundingBox boundingBoxLeft, boundingBoxRight;
+				splitAxes.push_back(FindMaxAxis(boundingBox, boundingBoxLeft, boundingBoxRight).aixType);
 			}
-			return true;
+
+			return SplitBoundingBoxOnAxes(boundingBox, splitAxes, childBoundingBoxes);
 		}
 
-		float Color8BitsToFloat(unsigned char color8Bit)
+		unsigned int TileToLOD::SplitBoundingBoxOnAxes(const osg::BoundingBox& boundingBox, const std::vector<int>& splitAxes, std::vector<osg::BoundingBox>& childBoundingBoxes)
 		{
-			float val = color8Bit / 255.f;
-			if (val < 0) val = 0.f;
-			if (val > 1.f) val = 1.f;
-			return val;
-		};
+			// child i lies on the upper side of splitAxes[k] if bit k of i is set
+			unsigned int childNum = 1 << splitAxes.size();
+			osg::Vec3 mid = boundingBox.center();
+			childBoundingBoxes.assign(childNum, boundingBox);
+			for (unsigned int i = 0; i < childNum; ++i)
+			{
+				for (size_t k = 0; k < splitAxes.size(); ++k)
+				{
+					int axis = splitAxes[k];
+					if (i & (1 << k))
+					{
+						childBoundingBoxes[i]._min[axis] = mid[axis];
+					}
+					else
+					{
+						childBoundingBoxes[i]._max[axis] = mid[axis];
+					}
+				}
+			}
+			return childNum;
+		}
 
-		osg::Geode *TileToLOD::MakeNodeGeode(const std::vector<PointCI> *pointSet,
-			std::vector<unsigned int> &pointIndex, ExportMode exportMode)
+		// number of chunks to split pointNum points into, one per core with at least 64k points each
+		static size_t ChunkNum(size_t pointNum)
 		{
-			if (pointIndex.size() <= 0)
+			return std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), pointNum / 65536));
+		}
+
+		// run body on chunks 0 to chunkNum - 1, one thread per chunk, the calling thread takes chunk 0
+		static void ForEachChunk(size_t chunkNum, const std::function<void(size_t)>& body)
+		{
+			std::vector<std::thread> threads;
+			for (size_t chunk = 1; chunk < chunkNum; ++chunk)
 			{
-				return 0;
+				threads.emplace_back(body, chunk);
 			}
-			osg::ref_ptr<osg::Geode> geode = new osg::Geode;
-			osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
-			osg::ref_ptr<osg::Vec3Array> pointArray = new osg::Vec3Array;
-			osg::ref_ptr<osg::Vec4Array> colorArray = new osg::Vec4Array;
-			osg::ref_ptr<osg::StateSet> set = new osg::StateSet;
-			osg::ref_ptr<osg::Point> point = new osg::Point;
-			
-			for (std::vector<unsigned int>::iterator i = pointIndex.begin(); i != pointIndex.end(); i++)
+			body(0);
+			for (auto& thread : threads)
 			{
-				PointCI tmpPoint = pointSet->at(*i);
-				pointArray->push_back(tmpPoint.P);
-				if (_colorMode == ColorMode::Debug)
+				thread.join();
+			}
+		}
+
+		// stable lsd radix sort of index by code, 8 bits per pass, chunks of each pass run in parallel
+		static void RadixSortByCode(std::vector<uint64_t>& codes, std::vector<unsigned int>& index)
+		{
+			const size_t pointNum = codes.size();
+			const size_t chunkNum = ChunkNum(pointNum);
+			const size_t chunkSize = (pointNum + chunkNum - 1) / chunkNum;
+			std::vector<std::array<size_t, 256>> histograms(chunkNum);
+			std::vector<uint64_t> codesSorted(pointNum);
+			std::vector<unsigned int> indexSorted(pointNum);
+
+			for (int shift = 0; shift < 64; shift += 8)
+			{
+				ForEachChunk(chunkNum, [&](size_t chunk)
 				{
-					colorArray->push_back(_colorBar[0]);
-				}
-				else if (_colorMode == ColorMode::RGB)
+					std::array<size_t, 256>& histogram = histograms[chunk];
+					histogram.fill(0);
+					size_t end = std::min(pointNum, (chunk + 1) * chunkSize);
+					for (size_t i = chunk * chunkSize; i < end; ++i)
+					{
+						histogram[(codes[i] >> shift) & 0xff]++;
+					}
+				});
+
+				// digit major, chunk minor offsets keep equal digits in input order
+				size_t offset = 0;
+				bool skip = false;
+				for (int digit = 0; digit < 256 && !skip; ++digit)
 				{
-					colorArray->push_back(
-						osg::Vec4(Color8BitsToFloat(tmpPoint.C[0]),
-							Color8BitsToFloat(tmpPoint.C[1]),
-							Color8BitsToFloat(tmpPoint.C[2]),
-						1.f));
+					size_t digitBegin = offset;
+					for (size_t chunk = 0; chunk < chunkNum; ++chunk)
+					{
+						size_t count = histograms[chunk][digit];
+						histograms[chunk][digit] = offset;
+						offset += count;
+					}
+					skip = (offset - digitBegin == pointNum);	// all codes share this digit
 				}
-				else if (_colorMode == ColorMode::IntensityGrey)
+				if (skip)
 				{
-					colorArray->push_back(_colorBar[tmpPoint.I]);
+					continue;
 				}
-				else if (_colorMode == ColorMode::IntensityBlueWhiteRed)
+
+				ForEachChunk(chunkNum, [&](size_t chunk)
+				{
+					std::array<size_t, 256>& position = histograms[chunk];
+					size_t end = std::min(pointNum, (chunk + 1) * chunkSize);
+					for (size_t i = chunk * chunkSize; i < end; ++i)
+					{
+						size_t target = position[(codes[i] >> shift) & 0xff]++;
+						codesSorted[target] = codes[i];
+						indexSorted[target] = index[i];
+					}
+				});
+				codes.swap(codesSorted);
+				index.swap(indexSorted);
+			}
+		}
+
+		std::shared_ptr<TileNode> TileToLOD::BuildTreeMorton(const std::vector<PointCI> *pointSet, osg::BoundingBox boundingBox)
+		{
+			// all nodes of a level have the same box size and so the same split axes,
+			// each level takes its split bits of the 63 bit code from the top down
+			std::vector<MortonLevel> levels;
+			int axisBits[3] = { 0, 0, 0 };
+			int bitsLeft = 63;
+			osg::BoundingBox levelBox = boundingBox;
+			while (levels.size() < _maxTreeLevel)
+			{
+				MortonLevel level;
+				std::vector<osg::BoundingBox> childBoundingBoxes;
+				SplitBoundingBox(levelBox, level.axes, childBoundingBoxes);
+				if ((int)level.axes.size() > bitsLeft)
 				{
-					colorArray->push_back(_colorBar[tmpPoint.I]);
+					break;
 				}
-				else if (_colorMode == ColorMode::IntensityHeightBlend)
+				bitsLeft -= level.axes.size();
+				level.shift = bitsLeft;
+				for (int axis : level.axes)
 				{
-					float x = (tmpPoint.P.z() - this->_boundingBoxGlobal.zMin()) / (this->_boundingBoxGlobal.zMax() - this->_boundingBoxGlobal.zMin());
-					//// sigmoid
-					//x = (x - 0.5) * 4;
-					//x = 1. / (1. + exp(-5 * x));
-					int index = x * 255;
-					index = std::max(0, std::min(255, index));
-					osg::Vec4 color = _colorBar[index];
-					color *= (tmpPoint.I / 255.);
-					color.w() = 1.0;
-					colorArray->push_back(color);
+					axisBits[axis]++;
 				}
+				levels.push_back(level);
+				levelBox = childBoundingBoxes[0];
 			}
 
-			if (_pointSize > 0)
+			// code bit (level.shift + k) is the next bit of the quantized coord on level.axes[k]
+			std::vector<std::pair<int, int>> bitSources;		// axis, bit in quantized coord
+			std::vector<int> bitTargets;
+			int axisBitsUsed[3] = { 0, 0, 0 };
+			for (const auto& level : levels)
 			{
-				point->setDistanceAttenuation(osg::Vec3(1.0f, 0.0f, 0.01f));
-				point->setSize(_pointSize);
-				set->setMode(GL_POINT_SMOOTH, osg::StateAttribute::ON);
-				set->setAttribute(point);
-				geometry->setStateSet(set);
+				for (size_t k = 0; k < level.axes.size(); ++k)
+				{
+					int axis = level.axes[k];
+					bitSources.push_back(std::make_pair(axis, axisBits[axis] - 1 - axisBitsUsed[axis]++));
+					bitTargets.push_back(level.shift + k);
+				}
+			}
+			double scale[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				double extent = boundingBox._max[axis] - boundingBox._min[axis];
+				scale[axis] = extent > 0 ? std::ldexp(1.0, axisBits[axis]) / extent : 0.;
 			}
-			geometry->setVertexArray(pointArray.get());
-			geometry->setColorArray(colorArray.get());
-			geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
 
-			geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::POINTS, 0, pointIndex.size()));
+			const size_t pointNum = pointSet->size();
+			std::vector<unsigned int> index(pointNum);
+			std::iota(index.begin(), index.end(), 0);
+			std::vector<uint64_t> codes(pointNum);
+			const size_t chunkNum = ChunkNum(pointNum);
+			const size_t chunkSize = (pointNum + chunkNum - 1) / chunkNum;
+			ForEachChunk(chunkNum, [&](size_t chunk)
+			{
+				size_t end = std::min(pointNum, (chunk + 1) * chunkSize);
+				for (size_t i = chunk * chunkSize; i < end; ++i)
+				{
+					const osg::Vec3& P = pointSet->at(i).P;
+					uint64_t quantized[3];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						uint64_t maxValue = axisBits[axis] ? (((uint64_t)1 << axisBits[axis]) - 1) : 0;
+						// split planes fall on integer values, ceil - 1 puts a point on one into the lower child like BuildNode
+						double value = (P[axis] - boundingBox._min[axis]) * scale[axis];
+						quantized[axis] = std::min(maxValue, (uint64_t)std::max(0., std::ceil(value) - 1.));
+					}
+					uint64_t code = 0;
+					for (size_t b = 0; b < bitTargets.size(); ++b)
+					{
+						code |= ((quantized[bitSources[b].first] >> bitSources[b].second) & 1) << bitTargets[b];
+					}
+					codes[i] = code;
+				}
+			});
+			RadixSortByCode(codes, index);
 
-			geometry->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-			geode->addDrawable(geometry.get());
-			return geode.release();
+			std::vector<uint64_t> codesScratch(codes.size());
+			std::vector<unsigned int> indexScratch(index.size());
+			return BuildNodeMorton(codes, index, codesScratch, indexScratch, 0, index.size(), boundingBox, levels, 0, 0);
 		}
 
-		bool TileToLOD::BuildNode(const std::vector<PointCI> *pointSet,
-			std::vector<unsigned int> &pointIndex,
+		std::shared_ptr<TileNode> TileToLOD::BuildNodeMorton(std::vector<uint64_t>& codes, std::vector<unsigned int>& index,
+			std::vector<uint64_t>& codesScratch, std::vector<unsigned int>& indexScratch,
+			size_t begin, size_t end,
 			osg::BoundingBox boundingBox,
-			osg::BoundingBox boundingBoxLevel0,
-			const std::string& saveFilePath,
-			const std::string& strBlock,
+			const std::vector<MortonLevel>& levels,
 			unsigned int level,
-			unsigned int childNo, 
-			ExportMode exportMode)
+			unsigned int childNo)
 		{
-			// format
-			std::string format;
-			if (exportMode == ExportMode::OSGB)
+			std::shared_ptr<TileNode> node = std::make_shared<TileNode>();
+			node->level = level;
+			node->childNo = childNo;
+			node->boundingBox = boundingBox;
+
+			// handle leaf case
+			size_t pointNum = end - begin;
+			if (pointNum < _maxPointNumPerOneNode || level >= _maxTreeLevel || level >= levels.size())
 			{
-				format = ".osgb";
+				node->pointIndex.assign(index.begin() + begin, index.begin() + end);
+				return node;
 			}
-			else if (exportMode == ExportMode::_3MX)
+
+			// split self, same sampling as BuildNode but along the morton order; the rest stays sorted
+			float interval = (float)pointNum / (float)_maxPointNumPerOneNode;
+			int count = -1;
+			size_t restEnd = begin;
+			node->pointIndex.reserve(_maxPointNumPerOneNode);
+			for (size_t i = begin; i < end; ++i)
 			{
-				format = ".3mxb";
+				int tmp = int((float)(i - begin) / interval);
+				if (tmp > count && node->pointIndex.size() < _maxPointNumPerOneNode)
+				{
+					count = tmp;
+					node->pointIndex.push_back(index[i]);
+				}
+				else
+				{
+					codesScratch[restEnd] = codes[i];
+					indexScratch[restEnd++] = index[i];
+				}
 			}
-			else
+			if (_phase == ProgressivePhase::Coarse && level + 1 >= _coarseLevels)
 			{
-				seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", exportMode);
-				return false;
+				return node;
 			}
+			std::copy(codesScratch.begin() + begin, codesScratch.begin() + restEnd, codes.begin() + begin);
+			std::copy(indexScratch.begin() + begin, indexScratch.begin() + restEnd, index.begin() + begin);
 
-			// filename of self, left, right
-			std::string saveFileName, leftPageName, rightPageName;
-			if (level == 0)
+			// children are the runs of equal split bits of this level
+			const MortonLevel& mortonLevel = levels[level];
+			std::vector<osg::BoundingBox> childBoundingBoxes;
+			unsigned int childNum = SplitBoundingBoxOnAxes(boundingBox, mortonLevel.axes, childBoundingBoxes);
+			uint64_t mask = childNum - 1;
+			size_t childBegin = begin;
+			while (childBegin < restEnd)
 			{
-				saveFileName = saveFilePath + "/" + strBlock + format;
+				unsigned int c = (codes[childBegin] >> mortonLevel.shift) & mask;
+				size_t childEnd = childBegin + 1;
+				while (childEnd < restEnd && ((codes[childEnd] >> mortonLevel.shift) & mask) == c)
+				{
+					++childEnd;
+				}
+				node->children.push_back(BuildNodeMorton(codes, index, codesScratch, indexScratch, childBegin, childEnd,
+					childBoundingBoxes[c], levels, level + 1, childNo * childNum + c));
+				childBegin = childEnd;
 			}
-			else
+			return node;
+		}
+
+		bool TileToLOD::Generate(const std::vector<PointCI> *pointSet,
+			const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, osg::BoundingBox& boundingBoxLevel0,
+			std::vector<PointCI>* samples)
+		{
+			std::vector<unsigned int> pointIndex;
+			osg::BoundingBox boundingBox;
+			for (int i = 0; i < pointSet->size(); i++)
 			{
-				char tmpSaveFileName[100];
-				sprintf(tmpSaveFileName, "%s%s%d%s%d%s", strBlock.c_str(), "_L", level, "_", childNo, format.c_str());
-				saveFileName.assign(tmpSaveFileName);
-				saveFileName = saveFilePath + "/" + saveFileName;
+				pointIndex.push_back(i);
+				boundingBox.expandBy(pointSet->at(i).P);
 			}
-			char tmpLeftPageName[100], tmpRightPageName[100];
-			sprintf(tmpLeftPageName, "%s%s%d%s%d%s", strBlock.c_str(), "_L", level + 1, "_", childNo * 2, format.c_str());
-			leftPageName.assign(tmpLeftPageName);
-			sprintf(tmpRightPageName, "%s%s%d%s%d%s", strBlock.c_str(), "_L", level + 1, "_", childNo * 2 + 1, format.c_str());
-			rightPageName.assign(tmpRightPageName);
-
-			// handle leaf case
-			if (pointIndex.size() < _maxPointNumPerOneNode || level >= _maxTreeLevel)
+			boundingBoxLevel0 = boundingBox;
+			osg::BoundingBox boundingBoxRoot = boundingBox;
+			if (exportMode == ExportMode::COPC)
+			{
+				// copc voxels halve a cube
+				osg::Vec3 extents = boundingBox._max - boundingBox._min;
+				float halfSize = std::max(extents.x(), std::max(extents.y(), extents.z())) / 2.f;
+				osg::Vec3 center = boundingBox.center();
+				boundingBoxRoot._min = center - osg::Vec3(halfSize, halfSize, halfSize);
+				boundingBoxRoot._max = center + osg::Vec3(halfSize, halfSize, halfSize);
+			}
+			try
 			{
-				osg::ref_ptr<osg::Geode> nodeGeode = MakeNodeGeode(pointSet, pointIndex, exportMode);
-				if (exportMode == ExportMode::OSGB)
+				std::shared_ptr<TileNode> root = (_buildEngine == BuildEngine::Morton) ?
+					BuildTreeMorton(pointSet, boundingBoxRoot) : BuildNode(pointSet, pointIndex, boundingBoxRoot, 0, 0);
+				if (_minPointNumPerOneNode > 0)
 				{
-					if (osgDB::writeNodeFile(*(nodeGeode.get()), saveFileName, new osgDB::ReaderWriter::Options("precision 20")) == false)
+					MergeSmallLeaves(root.get());
+				}
+				if (_maxPointScale > 1.f && (exportMode == ExportMode::OSGB || exportMode == ExportMode::_3MX))
+				{
+					double leafSpacing = 0.;
+					unsigned int leafNum = 0;
+					if (_phase == ProgressivePhase::Refine)
 					{
-						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
-						return false;
+						// coarse files are rewritten where the refined leaves change their scale
+						ScalePointSize(pointSet, root.get(), true, leafSpacing, leafNum);
+						leafSpacing = 0.;
+						leafNum = 0;
 					}
+					ScalePointSize(pointSet, root.get(), false, leafSpacing, leafNum);
 				}
-				else if (exportMode == ExportMode::_3MX)
+				if (samples)
 				{
-					if(ConvertOsgbTo3mxb(nodeGeode, saveFileName) == false)
+					// representative points of the tile for the overview above the tiles
+					size_t sampleNum = std::max(1u, _maxPointNumPerOneNode / 4);
+					double stride = std::max(1., (double)root->pointIndex.size() / sampleNum);
+					samples->clear();
+					for (double i = 0; i < root->pointIndex.size(); i += stride)
 					{
-						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
-						return false;
+						samples->push_back(pointSet->at(root->pointIndex[(size_t)i]));
 					}
 				}
-				else
+				if (exportMode == ExportMode::COPC)
+				{
+					return ExportCopc(pointSet, root.get(), boundingBox, saveFilePath);
+				}
+				_indexNodes.clear();
+				_indexIds.clear();
+				if (_hierarchyIndex)
+				{
+					AddIndexNode(root.get(), nullptr, 0.);
+				}
+				if (!ExportTree(pointSet, root.get(), boundingBoxLevel0, saveFilePath, strBlock, exportMode))
 				{
-					seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", exportMode);
 					return false;
 				}
-				return true;
+				if (exportMode == ExportMode::_3DTILES)
+				{
+					ExportTileset(pointSet, root.get(), saveFilePath, strBlock);
+				}
 			}
+			catch (...)
+			{
+				seed::log::DumpLog(seed::log::Critical, "KDTree generate error!");
+				return false;
+			}
+			return true;
+		}
 
-			// prepare box
-			AxisInfo maxAxisInfo;
-			osg::BoundingBox leftBoundingBox;
-			osg::BoundingBox rightBoundingBox;
-			maxAxisInfo = FindMaxAxis(boundingBox, leftBoundingBox, rightBoundingBox);
-			double mid = (maxAxisInfo.max + maxAxisInfo.min) / 2;
-
-			// split self, left, right
-			float interval = (float)pointIndex.size() / (float)_maxPointNumPerOneNode;
-			int count = -1;
-			std::vector<unsigned int> selfPointSetIndex;
-			std::vector<unsigned int> leftPointSetIndex;
-			std::vector<unsigned int> rightPointSetIndex;
-			for (int i = 0; i < pointIndex.size(); i++)
+		bool TileToLOD::GenerateOverview(const std::vector<PointCI> *pointSet,
+			const std::vector<NodeChild>& tiles, const std::vector<std::vector<unsigned int>>& tileSamples,
+			const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, osg::BoundingBox& boundingBoxOverview)
+		{
+			if (tiles.empty())
 			{
-				int tmp = int((float)i / interval);
-				if (tmp > count && selfPointSetIndex.size() < _maxPointNumPerOneNode)
+				seed::log::DumpLog(seed::log::Critical, "No tile for overview!");
+				return false;
+			}
+			std::vector<unsigned int> tileIds(tiles.size());
+			std::iota(tileIds.begin(), tileIds.end(), 0);
+			try
+			{
+				std::shared_ptr<Tile3dtiles> tile = std::make_shared<Tile3dtiles>();
+				std::shared_ptr<TileNode> root = ExportOverviewNode(pointSet, tiles, tileSamples, tileIds, 0, 0, saveFilePath, strBlock, exportMode, *tile);
+				if (!root)
 				{
-					count = tmp;
-					selfPointSetIndex.push_back(pointIndex[i]);
+					return false;
 				}
-				else
+				boundingBoxOverview = root->boundingBox;
+				if (exportMode == ExportMode::_3DTILES)
 				{
-					PointCI tmpPoint = pointSet->at(pointIndex[i]);
-					if (tmpPoint.P[int(maxAxisInfo.aixType)] > mid)
-					{
-						rightPointSetIndex.push_back(pointIndex[i]);
-					}
-					else
-					{
-						leftPointSetIndex.push_back(pointIndex[i]);
-					}
+					std::string saveFileName = saveFilePath + "/tileset.json";
+					_writeQueue->Push([tile, saveFileName]() { return GenerateTileset(*tile, osg::Vec3d(0, 0, 0), saveFileName); });
 				}
 			}
-
-			// export
+			catch (...)
 			{
-				osg::ref_ptr<osg::Group> mt(new osg::Group);
-				osg::ref_ptr<osg::Geode> nodeGeode = MakeNodeGeode(pointSet, selfPointSetIndex, exportMode);
-				mt->addChild(nodeGeode.get());
-				selfPointSetIndex.swap(std::vector<unsigned int>());
+				seed::log::DumpLog(seed::log::Critical, "Overview generate error!");
+				return false;
+			}
+			return _writeQueue->Flush();
+		}
 
-				double rangeRatio = 4.;
-				double rangeValue = boundingBoxLevel0.radius() * 2.f * _lodRatio * rangeRatio;
+		std::shared_ptr<TileNode> TileToLOD::ExportOverviewNode(const std::vector<PointCI> *pointSet,
+			const std::vector<NodeChild>& tiles, const std::vector<std::vector<unsigned int>>& tileSamples,
+			std::vector<unsigned int>& tileIds, unsigned int level, unsigned int childNo,
+			const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, Tile3dtiles& tile)
+		{
+			const unsigned int maxTileNumPerNode = 8;
+			std::string format = NodeFileFormat(exportMode);
+			std::shared_ptr<TileNode> node = std::make_shared<TileNode>();
+			node->level = level;
+			node->childNo = childNo;
+			for (auto id : tileIds)
+			{
+				node->boundingBox.expandBy(tiles[id].boundingBox);
+			}
 
-				if (leftPointSetIndex.size())
+			// children, tile roots or two halves split at the median tile along the longest axis
+			std::vector<NodeChild> children;
+			if (tileIds.size() <= maxTileNumPerNode)
+			{
+				for (auto id : tileIds)
 				{
-					osg::ref_ptr<osg::PagedLOD>  leftPageNode = new osg::PagedLOD;
-					leftPageNode->setRangeMode(osg::PagedLOD::PIXEL_SIZE_ON_SCREEN);
-					leftPageNode->setFileName(0, leftPageName);
-					leftPageNode->setRange(0, rangeValue, FLT_MAX);
-					leftPageNode->setCenter(leftBoundingBox.center());
-					leftPageNode->setRadius(leftBoundingBox.radius());
-					mt->addChild(leftPageNode.get());
-				}
+					std::shared_ptr<TileNode> tileNode = std::make_shared<TileNode>();
+					tileNode->boundingBox = tiles[id].boundingBox;
+					node->children.push_back(tileNode);
+					children.push_back(tiles[id]);
 
-				if (rightPointSetIndex.size())
+					// the tile tileset, its error is set below to refine into it along with this node
+					Tile3dtiles tileChild;
+					tileChild.bb = tiles[id].boundingBox;
+					tileChild.content = tiles[id].fileName;
+					tile.children.push_back(tileChild);
+				}
+			}
+			else
+			{
+				osg::BoundingBox boundingBoxCenters;
+				for (auto id : tileIds)
 				{
-					osg::ref_ptr<osg::PagedLOD>  rightPageNode = new osg::PagedLOD;
-					rightPageNode->setRangeMode(osg::PagedLOD::PIXEL_SIZE_ON_SCREEN);
-					rightPageNode->setFileName(0, rightPageName);
-					rightPageNode->setRange(0, rangeValue, FLT_MAX);
-					rightPageNode->setCenter(rightBoundingBox.center());
-					rightPageNode->setRadius(rightBoundingBox.radius());
-					mt->addChild(rightPageNode.get());
+					boundingBoxCenters.expandBy(tiles[id].boundingBox.center());
 				}
-				if (exportMode == ExportMode::OSGB)
+				osg::BoundingBox boundingBoxLeft, boundingBoxRight;
+				int axis = FindMaxAxis(boundingBoxCenters, boundingBoxLeft, boundingBoxRight).aixType;
+				std::vector<unsigned int>::iterator median = tileIds.begin() + tileIds.size() / 2;
+				std::nth_element(tileIds.begin(), median, tileIds.end(), [&](unsigned int a, unsigned int b)
+				{
+					return tiles[a].boundingBox.center()[axis] < tiles[b].boundingBox.center()[axis];
+				});
+				std::vector<unsigned int> halves[2] = { std::vector<unsigned int>(tileIds.begin(), median), std::vector<unsigned int>(median, tileIds.end()) };
+				for (unsigned int c = 0; c < 2; ++c)
 				{
-					if (osgDB::writeNodeFile(*(mt.get()), saveFileName, new osgDB::ReaderWriter::Options("precision 20")) == false)
+					tile.children.push_back(Tile3dtiles());
+					std::shared_ptr<TileNode> childNode = ExportOverviewNode(pointSet, tiles, tileSamples, halves[c], level + 1, childNo * 2 + c, saveFilePath, strBlock, exportMode, tile.children.back());
+					if (!childNode)
 					{
-						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
-						return false;
+						return nullptr;
 					}
+					NodeChild child;
+					child.fileName = NodeFileName(strBlock, childNode->level, childNode->childNo, format);
+					child.boundingBox = childNode->boundingBox;
+					children.push_back(child);
+					node->children.push_back(childNode);
 				}
-				else if (exportMode == ExportMode::_3MX)
+			}
+
+			// self, evenly taken from the samples of all tiles below
+			size_t sampleNum = 0;
+			for (auto id : tileIds)
+			{
+				sampleNum += tileSamples[id].size();
+			}
+			double stride = std::max(1., (double)sampleNum / _maxPointNumPerOneNode);
+			double next = 0;
+			size_t count = 0;
+			for (auto id : tileIds)
+			{
+				for (auto i : tileSamples[id])
 				{
-					if (ConvertOsgbTo3mxb(mt, saveFileName) == false)
+					if (count++ >= next)
 					{
-						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
-						return false;
+						node->pointIndex.push_back(i);
+						next += stride;
 					}
 				}
-				else
+			}
+			double spacing = PointSpacing(pointSet, node.get());
+			for (auto& child : children)
+			{
+				child.range = PagingRange(spacing, child.boundingBox, node->boundingBox.radius() * 2. * RefinePixels());
+			}
+			tile.bb = node->boundingBox;
+			tile.geometricError = GeometricError(spacing);
+			tile.content = NodeFileName(strBlock, level, childNo, format);
+			if (tileIds.size() <= maxTileNumPerNode)
+			{
+				for (auto& tileChild : tile.children)
 				{
-					seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", exportMode);
-					return false;
+					tileChild.geometricError = tile.geometricError;
 				}
 			}
 
-			// recursive left
-			if (leftPointSetIndex.size())
+			// write
+			std::vector<TileNode*> nextNodes;
+			std::string saveFileName = saveFilePath + "/" + NodeFileName(strBlock, level, childNo, format);
+			std::function<bool(const std::string&)> writeFile = ExportNode(pointSet, node.get(), children, nullptr, exportMode, nextNodes);
+			if (!writeFile)
+			{
+				return nullptr;
+			}
+			_writeQueue->Push([writeFile, saveFileName]() { return writeFile(saveFileName); });
+			std::vector<unsigned int>().swap(node->pointIndex);
+			return node;
+		}
+
+		// per output type color operations used by the color kernels
+		static inline void SetColor(osg::Vec4& color, unsigned char r, unsigned char g, unsigned char b)
+		{
+			color.set(r * (1.f / 255.f), g * (1.f / 255.f), b * (1.f / 255.f), 1.f);
+		}
+
+		static inline void SetColor(osg::Vec4ub& color, unsigned char r, unsigned char g, unsigned char b)
+		{
+			color.set(r, g, b, 255);
+		}
+
+		static inline void SetColor(osg::Vec3ub& color, unsigned char r, unsigned char g, unsigned char b)
+		{
+			color.set(r, g, b);
+		}
+
+		static inline void ScaleColor(osg::Vec4& color, const osg::Vec4& base, unsigned char scale)
+		{
+			float s = scale * (1.f / 255.f);
+			color.set(base.r() * s, base.g() * s, base.b() * s, 1.f);
+		}
+
+		static inline void ScaleColor(osg::Vec4ub& color, const osg::Vec4ub& base, unsigned char scale)
+		{
+			color.set((base.r() * scale + 127) / 255, (base.g() * scale + 127) / 255, (base.b() * scale + 127) / 255, 255);
+		}
+
+		static inline void ScaleColor(osg::Vec3ub& color, const osg::Vec3ub& base, unsigned char scale)
+		{
+			color.set((base.r() * scale + 127) / 255, (base.g() * scale + 127) / 255, (base.b() * scale + 127) / 255);
+		}
+
+		template<ColorMode mode, typename ColorT>
+		void TileToLOD::ColorKernel(const std::vector<PointCI> *pointSet,
+			const unsigned int* pointIndex, size_t pointNum, ColorT* colors)
+		{
+			const ColorT* colorBar = GetColorBar((ColorT*)nullptr);
+			const PointCI* points = pointSet->data();
+			if (mode == ColorMode::Debug)
 			{
-				BuildNode(pointSet, leftPointSetIndex, leftBoundingBox, boundingBoxLevel0, saveFilePath, strBlock, level + 1, childNo * 2, exportMode);
-				leftPointSetIndex.swap(std::vector<unsigned int>());
+				std::fill(colors, colors + pointNum, colorBar[0]);
 			}
-			// recursive right
-			if (rightPointSetIndex.size())
+			else if (mode == ColorMode::RGB)
 			{
-				BuildNode(pointSet, rightPointSetIndex, rightBoundingBox, boundingBoxLevel0, saveFilePath, strBlock, level + 1, childNo * 2 + 1, exportMode);
-				rightPointSetIndex.swap(std::vector<unsigned int>());
+				for (size_t i = 0; i < pointNum; ++i)
+				{
+					const PointCI& point = points[pointIndex[i]];
+					SetColor(colors[i], point.C[0], point.C[1], point.C[2]);
+				}
+			}
+			else if (mode == ColorMode::IntensityGrey || mode == ColorMode::IntensityBlueWhiteRed)
+			{
+				for (size_t i = 0; i < pointNum; ++i)
+				{
+					colors[i] = colorBar[points[pointIndex[i]].I];
+				}
+			}
+			else if (mode == ColorMode::IntensityHeightBlend)
+			{
+				// gather a block, then run the height to index mapping on plain arrays so it vectorizes
+				const size_t blockSize = 256;
+				float z[blockSize];
+				int index[blockSize];
+				unsigned char intensity[blockSize];
+				float zMin = _boundingBoxGlobal.zMin();
+				float zRange = _boundingBoxGlobal.zMax() - _boundingBoxGlobal.zMin();
+				float zScale = zRange > 0 ? 255.f / zRange : 0.f;
+				for (size_t begin = 0; begin < pointNum; begin += blockSize)
+				{
+					size_t count = std::min(blockSize, pointNum - begin);
+					for (size_t i = 0; i < count; ++i)
+					{
+						const PointCI& point = points[pointIndex[begin + i]];
+						z[i] = point.P.z();
+						intensity[i] = point.I;
+					}
+					for (size_t i = 0; i < count; ++i)
+					{
+						int k = (int)((z[i] - zMin) * zScale);
+						index[i] = k < 0 ? 0 : (k > 255 ? 255 : k);
+					}
+					for (size_t i = 0; i < count; ++i)
+					{
+						ScaleColor(colors[begin + i], colorBar[index[i]], intensity[i]);
+					}
+				}
+			}
+		}
+
+		template<typename ColorT>
+		void TileToLOD::Colorize(const std::vector<PointCI> *pointSet,
+			const unsigned int* pointIndex, size_t pointNum, ColorT* colors)
+		{
+			// dispatch once per node, each kernel is specialized for its mode and output type
+			switch (_colorMode)
+			{
+			case ColorMode::Debug:
+				ColorKernel<ColorMode::Debug>(pointSet, pointIndex, pointNum, colors);
+				break;
+			case ColorMode::RGB:
+				ColorKernel<ColorMode::RGB>(pointSet, pointIndex, pointNum, colors);
+				break;
+			case ColorMode::IntensityGrey:
+				ColorKernel<ColorMode::IntensityGrey>(pointSet, pointIndex, pointNum, colors);
+				break;
+			case ColorMode::IntensityBlueWhiteRed:
+				ColorKernel<ColorMode::IntensityBlueWhiteRed>(pointSet, pointIndex, pointNum, colors);
+				break;
+			case ColorMode::IntensityHeightBlend:
+				ColorKernel<ColorMode::IntensityHeightBlend>(pointSet, pointIndex, pointNum, colors);
+				break;
+			default:
+				break;
+			}
+		}
+
+		osg::Geode *TileToLOD::MakeNodeGeode(const std::vector<PointCI> *pointSet,
+			std::vector<unsigned int> &pointIndex, float pointSize, ExportMode exportMode)
+		{
+			if (pointIndex.size() <= 0)
+			{
+				return 0;
+			}
+			osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+			osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+			osg::ref_ptr<osg::Vec3Array> pointArray = new osg::Vec3Array;
+			osg::ref_ptr<osg::StateSet> set = new osg::StateSet;
+			osg::ref_ptr<osg::Point> point = new osg::Point;
+			
+			pointArray->resize(pointIndex.size());
+			for (size_t i = 0; i < pointIndex.size(); i++)
+			{
+				(*pointArray)[i] = pointSet->at(pointIndex[i]).P;
+			}
+
+			// 8-bit colors are normalized to [0, 1] by the viewer
+			osg::ref_ptr<osg::Array> colorArray;
+			if (_colorFormat == ColorFormat::UByte4)
+			{
+				osg::ref_ptr<osg::Vec4ubArray> colorArrayUByte4 = new osg::Vec4ubArray(pointIndex.size());
+				Colorize(pointSet, pointIndex.data(), pointIndex.size(), &colorArrayUByte4->front());
+				colorArrayUByte4->setNormalize(true);
+				colorArray = colorArrayUByte4;
+			}
+			else if (_colorFormat == ColorFormat::UByte3)
+			{
+				osg::ref_ptr<osg::Vec3ubArray> colorArrayUByte3 = new osg::Vec3ubArray(pointIndex.size());
+				Colorize(pointSet, pointIndex.data(), pointIndex.size(), &colorArrayUByte3->front());
+				colorArrayUByte3->setNormalize(true);
+				colorArray = colorArrayUByte3;
+			}
+			else
+			{
+				osg::ref_ptr<osg::Vec4Array> colorArrayFloat4 = new osg::Vec4Array(pointIndex.size());
+				Colorize(pointSet, pointIndex.data(), pointIndex.size(), &colorArrayFloat4->front());
+				colorArray = colorArrayFloat4;
+			}
+
+			if (pointSize > 0)
+			{
+				point->setDistanceAttenuation(osg::Vec3(1.0f, 0.0f, 0.01f));
+				point->setSize(pointSize);
+				set->setMode(GL_POINT_SMOOTH, osg::StateAttribute::ON);
+				set->setAttribute(point);
+				geometry->setStateSet(set);
+			}
+			geometry->setVertexArray(pointArray.get());
+			geometry->setColorArray(colorArray.get());
+			geometry->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+
+			geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::POINTS, 0, pointIndex.size()));
+
+			geometry->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+			geode->addDrawable(geometry.get());
+			return geode.release();
+		}
+
+		// re-encode the raw "xyz" buffers of resources as quantized positions, on the writer threads.
+		// resources failing to encode stay "xyz"
+		static void QuantizeResources(std::vector<Resource3mx>& resources, unsigned int flags)
+		{
+			for (auto& resource : resources)
+			{
+				if (resource.format != "xyz")
+				{
+					continue;
+				}
+				// <int32 num><float xyz * num><uint8 rgba * num>, see doc/extended3mx.md
+				int pointNum = 0;
+				memcpy(&pointNum, resource.bufferData.data(), 4);
+				const float* xyz = (const float*)(resource.bufferData.data() + 4);
+				const unsigned char* rgba = (const unsigned char*)(xyz + 3 * pointNum);
+				std::vector<char> bufferQuantized;
+				if (PointCloudToQuantizedBuffer(xyz, rgba, pointNum, flags, bufferQuantized, resource.bb))
+				{
+					resource.bufferData.swap(bufferQuantized);
+					resource.format = "xyzq";
+				}
+			}
+		}
+
+		std::vector<std::string> TileToLOD::MakeNode3mx(const std::vector<PointCI> *pointSet,
+			TileNode* node, unsigned int depth, const std::vector<NodeChild>& children,
+			std::vector<Node3mx>& nodes, std::vector<Resource3mx>& resources,
+			const std::function<std::vector<NodeChild>(TileNode*)>& makeChildren,
+			std::vector<TileNode*>& nextNodes)
+		{
+			// same layout ConvertOsgbTo3mxb produces for a group of geode + paged lods:
+			// one node always shows the points, one node per child pages the child in.
+			// inside a bundle the child is referenced as "#<id>" of the same file, see doc/extended3mx.md
+			std::vector<std::string> topIds;
+			Node3mx self;
+			self.id = "node" + std::to_string(nodes.size());
+			self.maxScreenDiameter = 1e30;
+
+			std::vector<unsigned int>& pointIndex = node->pointIndex;
+			if (pointIndex.size())
+			{
+				Resource3mx resource;
+				resource.type = "geometryBuffer";
+				resource.format = "xyz";
+				resource.id = "geometry" + std::to_string(resources.size());
+				resource.pointSize = (_pointSize > 0 ? _pointSize : 10.f) * node->pointScale;
+
+				// <int32 num><float xyz * num><uint8 rgba * num>, see doc/extended3mx.md
+				int pointNum = pointIndex.size();
+				resource.bufferData.resize(4 + pointNum * (3 * sizeof(float) + 4));
+				char* buffer = resource.bufferData.data();
+				memcpy(buffer, &pointNum, 4);
+				float* xyz = (float*)(buffer + 4);
+				unsigned char* rgba = (unsigned char*)(xyz + 3 * pointNum);
+				for (int i = 0; i < pointNum; ++i)
+				{
+					const PointCI& tmpPoint = pointSet->at(pointIndex[i]);
+					xyz[3 * i + 0] = tmpPoint.P.x();
+					xyz[3 * i + 1] = tmpPoint.P.y();
+					xyz[3 * i + 2] = tmpPoint.P.z();
+					resource.bb.expandBy(tmpPoint.P);
+				}
+				Colorize(pointSet, pointIndex.data(), pointIndex.size(), (osg::Vec4ub*)rgba);
+				self.bb = resource.bb;
+				self.resources.push_back(resource.id);
+				resources.push_back(std::move(resource));
+			}
+			topIds.push_back(self.id);
+			nodes.push_back(std::move(self));
+
+			for (size_t i = 0; i < children.size(); ++i)
+			{
+				// nodes may grow while the subtree is added, address the link by position
+				size_t linkPos = nodes.size();
+				nodes.push_back(Node3mx());
+				nodes[linkPos].id = "node" + std::to_string(linkPos);
+				nodes[linkPos].bb = children[i].boundingBox;
+				nodes[linkPos].maxScreenDiameter = children[i].range;
+				TileNode* childNode = node->children[i].get();
+				if (depth + 1 < _bundleLevels)
+				{
+					std::vector<std::string> childIds = MakeNode3mx(pointSet, childNode, depth + 1, makeChildren(childNode),
+						nodes, resources, makeChildren, nextNodes);
+					for (const auto& childId : childIds)
+					{
+						nodes[linkPos].children.push_back("#" + childId);
+					}
+				}
+				else
+				{
+					nodes[linkPos].children.push_back(children[i].fileName);
+					nextNodes.push_back(childNode);
+				}
+				topIds.push_back(nodes[linkPos].id);
+			}
+			return topIds;
+		}
+
+		std::function<bool(const std::string&)> TileToLOD::ExportNode(const std::vector<PointCI> *pointSet,
+			TileNode* node, const std::vector<NodeChild>& children,
+			const std::function<std::vector<NodeChild>(TileNode*)>& makeChildren,
+			ExportMode exportMode,
+			std::vector<TileNode*>& nextNodes)
+		{
+			// encoding and disk io run on writer threads, the queue blocks BuildNode when writers fall behind
+			if (exportMode == ExportMode::OSGB)
+			{
+				osg::ref_ptr<osg::Node> geode = MakeNodeGeode(pointSet, node->pointIndex, _pointSize * node->pointScale, exportMode);
+				if (children.size())
+				{
+					osg::ref_ptr<osg::Group> mt(new osg::Group);
+					mt->addChild(geode.get());
+					for (const auto& child : children)
+					{
+						osg::ref_ptr<osg::PagedLOD> childPageNode = new osg::PagedLOD;
+						childPageNode->setRangeMode(osg::PagedLOD::PIXEL_SIZE_ON_SCREEN);
+						childPageNode->setFileName(0, child.fileName);
+						childPageNode->setRange(0, child.range, FLT_MAX);
+						childPageNode->setCenter(child.boundingBox.center());
+						childPageNode->setRadius(child.boundingBox.radius());
+						mt->addChild(childPageNode.get());
+					}
+					geode = mt;
+				}
+				for (auto& childNode : node->children)
+				{
+					nextNodes.push_back(childNode.get());
+				}
+				// compression runs with the write on the writer threads
+				std::string options = "precision 20";
+				if (!_osgbCompressor.empty())
+				{
+					options += " Compressor=" + _osgbCompressor;
+				}
+				return [geode, options](const std::string& saveFileName)
+				{
+					if (osgDB::writeNodeFile(*(geode.get()), saveFileName, new osgDB::ReaderWriter::Options(options)) == false)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
+						return false;
+					}
+					return true;
+				};
+			}
+			else if (exportMode == ExportMode::_3MX)
+			{
+				std::shared_ptr<std::vector<Node3mx>> nodes = std::make_shared<std::vector<Node3mx>>();
+				std::shared_ptr<std::vector<Resource3mx>> resources = std::make_shared<std::vector<Resource3mx>>();
+				MakeNode3mx(pointSet, node, 0, children, *nodes, *resources, makeChildren, nextNodes);
+				// quantization and lzma run with the write on the writer threads
+				bool quantize = _pointFormat != PointFormat::Xyz;
+				unsigned int flags = _pointFormat == PointFormat::XyzqLzma ? (QUANTIZED_MORTON_DELTA | QUANTIZED_LZMA) : 0;
+				std::shared_ptr<ArchiveWriter> archive = _archive;
+				if (archive)
+				{
+					return [nodes, resources, quantize, flags, archive](const std::string& saveFileName)
+					{
+						if (quantize)
+						{
+							QuantizeResources(*resources, flags);
+						}
+						thread_local std::vector<char> buffer;
+						Generate3mxb(*nodes, *resources, std::vector<Resource3mx>(), buffer);
+						return archive->Append(osgDB::getSimpleFileName(saveFileName), buffer.data(), buffer.size());
+					};
+				}
+				return [nodes, resources, quantize, flags](const std::string& saveFileName)
+				{
+					if (quantize)
+					{
+						QuantizeResources(*resources, flags);
+					}
+					if (Generate3mxb(*nodes, *resources, std::vector<Resource3mx>(), saveFileName) == false)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
+						return false;
+					}
+					return true;
+				};
+			}
+			else if (exportMode == ExportMode::_3DTILES)
+			{
+				// children are linked from the tileset, see ExportTileset
+				std::vector<unsigned int>& pointIndex = node->pointIndex;
+				std::shared_ptr<std::vector<float>> xyz = std::make_shared<std::vector<float>>(3 * pointIndex.size());
+				std::shared_ptr<std::vector<osg::Vec3ub>> rgb = std::make_shared<std::vector<osg::Vec3ub>>(pointIndex.size());
+				for (size_t i = 0; i < pointIndex.size(); ++i)
+				{
+					const PointCI& tmpPoint = pointSet->at(pointIndex[i]);
+					(*xyz)[3 * i + 0] = tmpPoint.P.x();
+					(*xyz)[3 * i + 1] = tmpPoint.P.y();
+					(*xyz)[3 * i + 2] = tmpPoint.P.z();
+				}
+				if (pointIndex.size())
+				{
+					Colorize(pointSet, pointIndex.data(), pointIndex.size(), rgb->data());
+				}
+				for (auto& childNode : node->children)
+				{
+					nextNodes.push_back(childNode.get());
+				}
+				return [xyz, rgb](const std::string& saveFileName)
+				{
+					if (GeneratePnts(xyz->data(), (const unsigned char*)rgb->data(), (int)rgb->size(), saveFileName) == false)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Write node file %s failed!", saveFileName.c_str());
+						return false;
+					}
+					return true;
+				};
+			}
+			else
+			{
+				seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", exportMode);
+				return nullptr;
+			}
+		}
+
+		// write beside the file and rename over it, viewers never read a half written node
+		static bool ReplaceNodeFile(const std::function<bool(const std::string&)>& writeFile, const std::string& saveFileName)
+		{
+			std::string tmpFileName = osgDB::getNameLessExtension(saveFileName) + ".tmp" + osgDB::getFileExtensionIncludingDot(saveFileName);
+			if (!writeFile(tmpFileName))
+			{
+				return false;
+			}
+			std::error_code error;
+			std::filesystem::rename(tmpFileName, saveFileName, error);
+			if (error)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Replace file %s failed: %s", saveFileName.c_str(), error.message().c_str());
+				return false;
+			}
+			return true;
+		}
+
+		void TileToLOD::CommitDeferredWrites()
+		{
+			for (auto& write : _deferredWrites)
+			{
+				_writeQueue->Push(write);
+			}
+			_deferredWrites.clear();
+		}
+
+		void TileToLOD::AddIndexNode(const TileNode* node, const TileNode* parent, double range)
+		{
+			if (_indexIds.count(node))
+			{
+				return;
+			}
+			IndexNode indexNode;
+			indexNode.parent = parent ? _indexIds.at(parent) : -1;
+			indexNode.level = node->level;
+			indexNode.childNo = node->childNo;
+			indexNode.pointNum = node->pointIndex.size();
+			indexNode.boundingBox = node->boundingBox;
+			indexNode.maxScreenDiameter = range;
+			_indexIds[node] = _indexNodes.size();
+			_indexNodes.push_back(indexNode);
+		}
+
+		void TileToLOD::SetIndexFile(const TileNode* node, const std::vector<TileNode*>& nextNodes, const std::string& fileName)
+		{
+			auto it = _indexIds.find(node);
+			if (it != _indexIds.end())
+			{
+				_indexNodes[it->second].fileName = fileName;
+			}
+			for (auto& childNode : node->children)
+			{
+				if (std::find(nextNodes.begin(), nextNodes.end(), childNode.get()) == nextNodes.end())
+				{
+					SetIndexFile(childNode.get(), nextNodes, fileName);
+				}
+			}
+		}
+
+		bool TileToLOD::SaveHierarchyIndex(const std::string& saveFilePath, const std::string& strBlock)
+		{
+			// files in order of their first node, bundled nodes share one
+			std::vector<std::string> fileNames;
+			std::map<std::string, uint32_t> fileIds;
+			for (auto& indexNode : _indexNodes)
+			{
+				if (fileIds.emplace(indexNode.fileName, (uint32_t)fileNames.size()).second)
+				{
+					fileNames.push_back(indexNode.fileName);
+				}
+			}
+
+			std::vector<char> buffer;
+			auto put = [&buffer](const void* data, size_t size)
+			{
+				buffer.insert(buffer.end(), (const char*)data, (const char*)data + size);
+			};
+			const uint32_t version = 1;
+			uint32_t nodeNum = _indexNodes.size();
+			put("LODI", 4);
+			put(&version, 4);
+			put(&nodeNum, 4);
+			for (auto& indexNode : _indexNodes)
+			{
+				int32_t parent = indexNode.parent;
+				uint32_t fields[3] = { indexNode.level, indexNode.childNo, indexNode.pointNum };
+				float bounds[7] = { indexNode.boundingBox.xMin(), indexNode.boundingBox.yMin(), indexNode.boundingBox.zMin(),
+					indexNode.boundingBox.xMax(), indexNode.boundingBox.yMax(), indexNode.boundingBox.zMax(), indexNode.maxScreenDiameter };
+				uint32_t fileId = fileIds[indexNode.fileName];
+				put(&parent, 4);
+				put(fields, sizeof(fields));
+				put(bounds, sizeof(bounds));
+				put(&fileId, 4);
+			}
+			uint32_t fileNum = fileNames.size();
+			put(&fileNum, 4);
+			for (auto& fileName : fileNames)
+			{
+				// a plain file starts at 0, an archive entry where it was appended last
+				ArchiveEntry entry{ 0, 0 };
+				if (_archive)
+				{
+					if (!_archive->Find(fileName, entry))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Can NOT find %s in archive!", fileName.c_str());
+						return false;
+					}
+				}
+				else
+				{
+					std::error_code error;
+					entry.size = std::filesystem::file_size(saveFilePath + "/" + fileName, error);
+					if (error)
+					{
+						seed::log::DumpLog(seed::log::Critical, "Can NOT get size of file %s!", (saveFilePath + "/" + fileName).c_str());
+						return false;
+					}
+				}
+				uint32_t nameLength = fileName.size();
+				put(&entry.offset, 8);
+				put(&entry.size, 8);
+				put(&nameLength, 4);
+				put(fileName.data(), nameLength);
+			}
+
+			std::string indexName = strBlock + ".index";
+			if (_archive)
+			{
+				return _archive->Append(indexName, buffer.data(), buffer.size());
+			}
+			std::string output = saveFilePath + "/" + indexName;
+			std::ofstream outfile(output, std::ios::out | std::ios::binary);
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
+				return false;
+			}
+			outfile.write(buffer.data(), buffer.size());
+			if (outfile.bad())
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		std::shared_ptr<TileNode> TileToLOD::BuildNode(const std::vector<PointCI> *pointSet,
+			std::vector<unsigned int> &pointIndex,
+			osg::BoundingBox boundingBox,
+			unsigned int level,
+			unsigned int childNo)
+		{
+			std::shared_ptr<TileNode> node = std::make_shared<TileNode>();
+			node->level = level;
+			node->childNo = childNo;
+			node->boundingBox = boundingBox;
+
+			// handle leaf case
+			if (pointIndex.size() < _maxPointNumPerOneNode || level >= _maxTreeLevel)
+			{
+				node->pointIndex.swap(pointIndex);
+				return node;
+			}
+
+			// prepare box
+			std::vector<int> splitAxes;
+			std::vector<osg::BoundingBox> childBoundingBoxes;
+			unsigned int childNum = SplitBoundingBox(boundingBox, splitAxes, childBoundingBoxes);
+			osg::Vec3 mid = boundingBox.center();
+
+			// split self, children; the coarse pass keeps only self points of its last level
+			bool lastCoarseLevel = (_phase == ProgressivePhase::Coarse && level + 1 >= _coarseLevels);
+			float interval = (float)pointIndex.size() / (float)_maxPointNumPerOneNode;
+			int count = -1;
+			std::vector<std::vector<unsigned int>> childPointSetIndex(childNum);
+			for (int i = 0; i < pointIndex.size(); i++)
+			{
+				int tmp = int((float)i / interval);
+				if (tmp > count && node->pointIndex.size() < _maxPointNumPerOneNode)
+				{
+					count = tmp;
+					node->pointIndex.push_back(pointIndex[i]);
+				}
+				else if (!lastCoarseLevel)
+				{
+					const PointCI& tmpPoint = pointSet->at(pointIndex[i]);
+					unsigned int c = 0;
+					for (size_t k = 0; k < splitAxes.size(); ++k)
+					{
+						if (tmpPoint.P[splitAxes[k]] > mid[splitAxes[k]])
+						{
+							c |= 1 << k;
+						}
+					}
+					childPointSetIndex[c].push_back(pointIndex[i]);
+				}
+			}
+			std::vector<unsigned int>().swap(pointIndex);
+
+			// recursive children
+			for (unsigned int c = 0; c < childNum; ++c)
+			{
+				if (childPointSetIndex[c].size())
+				{
+					node->children.push_back(BuildNode(pointSet, childPointSetIndex[c], childBoundingBoxes[c], level + 1, childNo * childNum + c));
+				}
+			}
+			return node;
+		}
+
+		void TileToLOD::MergeSmallLeaves(TileNode* node)
+		{
+			// post-order, so a child that lost all its children to itself can be folded in turn.
+			// progressive passes keep the coarse levels as the coarse pass wrote them, nothing is folded into them
+			bool keepNode = _phase != ProgressivePhase::Full && node->level < _coarseLevels;
+			std::vector<std::shared_ptr<TileNode>> children;
+			for (auto& child : node->children)
+			{
+				MergeSmallLeaves(child.get());
+				if (!keepNode && child->children.empty() && child->pointIndex.size() < _minPointNumPerOneNode)
+				{
+					node->pointIndex.insert(node->pointIndex.end(), child->pointIndex.begin(), child->pointIndex.end());
+				}
+				else
+				{
+					children.push_back(child);
+				}
+			}
+			node->children.swap(children);
+		}
+
+		double TileToLOD::PagingRange(double parentSpacing, const osg::BoundingBox& childBoundingBox, double fallback)
+		{
+			// a child pages in once the point spacing of its parent covers RefinePixels on screen:
+			// spacing * pixelsPerUnit > RefinePixels  <=>  childDiameter * pixelsPerUnit > RefinePixels * childDiameter / spacing
+			return parentSpacing > 0 ? RefinePixels() * childBoundingBox.radius() * 2. / parentSpacing : fallback;
+		}
+
+		double TileToLOD::GeometricError(double spacing)
+		{
+			// viewers refine once error * pixelsPerUnit exceeds their maximum screen space error:
+			// spacing * pixelsPerUnit > RefinePixels  <=>  spacing * _screenSpaceError / RefinePixels * pixelsPerUnit > _screenSpaceError
+			return RefinePixels() > 0 ? spacing * _screenSpaceError / RefinePixels() : 0.;
+		}
+
+		double TileToLOD::PointSpacing(const std::vector<PointCI> *pointSet, TileNode* node)
+		{
+			// points are taken as spread over the two largest extents of their bounds, as for surface scans
+			osg::BoundingBox boundingBox;
+			for (auto i : node->pointIndex)
+			{
+				boundingBox.expandBy(pointSet->at(i).P);
+			}
+			if (!boundingBox.valid())
+			{
+				return 0.;
+			}
+			double extents[3] = { boundingBox.xMax() - boundingBox.xMin(), boundingBox.yMax() - boundingBox.yMin(), boundingBox.zMax() - boundingBox.zMin() };
+			std::sort(extents, extents + 3);
+			double pointNum = node->pointIndex.size();
+			if (extents[1] > 0)
+			{
+				return std::sqrt(extents[2] * extents[1] / pointNum);
+			}
+			return extents[2] / pointNum;
+		}
+
+		void TileToLOD::ScalePointSize(const std::vector<PointCI> *pointSet, TileNode* node, bool coarse, double& leafSpacing, unsigned int& leafNum)
+		{
+			// leaves are the full density, a coarse node is as many times sparser as its spacing is over the one of its leaves
+			double spacing = PointSpacing(pointSet, node);
+			float& pointScale = coarse ? node->coarsePointScale : node->pointScale;
+			pointScale = 1.f;
+			if (node->children.empty() || (coarse && node->level + 1 >= _coarseLevels))
+			{
+				if (spacing > 0)
+				{
+					leafSpacing += spacing;
+					leafNum++;
+				}
+				return;
+			}
+			double childLeafSpacing = 0.;
+			unsigned int childLeafNum = 0;
+			for (auto& childNode : node->children)
+			{
+				ScalePointSize(pointSet, childNode.get(), coarse, childLeafSpacing, childLeafNum);
+			}
+			if (spacing > 0 && childLeafNum > 0)
+			{
+				pointScale = std::min(std::max(1., spacing * childLeafNum / childLeafSpacing), (double)_maxPointScale);
+			}
+			leafSpacing += childLeafSpacing;
+			leafNum += childLeafNum;
+		}
+
+		std::string TileToLOD::NodeFileName(const std::string& strBlock, unsigned int level, unsigned int childNo, const std::string& format)
+		{
+			if (level == 0)
+			{
+				return strBlock + format;
+			}
+			char tmpSaveFileName[100];
+			sprintf(tmpSaveFileName, "%s%s%d%s%d%s", strBlock.c_str(), "_L", level, "_", childNo, format.c_str());
+			return std::string(tmpSaveFileName);
+		}
+
+		bool TileToLOD::ExportTree(const std::vector<PointCI> *pointSet,
+			TileNode* node,
+			osg::BoundingBox boundingBoxLevel0,
+			const std::string& saveFilePath,
+			const std::string& strBlock,
+			ExportMode exportMode)
+		{
+			// format
+			std::string format = NodeFileFormat(exportMode);
+			if (format.empty())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Mode %d is NOT support!", exportMode);
+				return false;
+			}
+
+			// export
+			double rangeValueLevel0 = boundingBoxLevel0.radius() * 2.f * RefinePixels();
+			auto makeChildren = [&](TileNode* parent)
+			{
+				std::vector<NodeChild> children;
+				double spacing = PointSpacing(pointSet, parent);
+				for (auto& childNode : parent->children)
+				{
+					NodeChild child;
+					child.fileName = NodeFileName(strBlock, childNode->level, childNode->childNo, format);
+					child.boundingBox = childNode->boundingBox;
+					child.range = PagingRange(spacing, childNode->boundingBox, rangeValueLevel0);
+					children.push_back(child);
+					if (_hierarchyIndex)
+					{
+						AddIndexNode(childNode.get(), parent, child.range);
+					}
+				}
+				return children;
+			};
+
+			// one file per node, or per bundle of _bundleLevels levels in 3mx mode
+			std::vector<TileNode*> nextNodes;
+			std::string fileName = NodeFileName(strBlock, node->level, node->childNo, format);
+			std::string saveFileName = saveFilePath + "/" + fileName;
+			std::function<bool(const std::string&)> writeFile = ExportNode(pointSet, node, makeChildren(node), makeChildren, exportMode, nextNodes);
+			if (!writeFile)
+			{
+				return false;
+			}
+			if (_hierarchyIndex)
+			{
+				SetIndexFile(node, nextNodes, fileName);
+			}
+			if (_phase == ProgressivePhase::Refine && node->level < _coarseLevels)
+			{
+				// already written by the coarse pass, only files holding or linking nodes below the coarse levels change,
+				// or holding nodes whose point scale changed with the refined leaves. 3d tiles nodes do not link, the tileset does
+				std::function<bool(TileNode*)> refined = [&](TileNode* fileNode)
+				{
+					if (fileNode->pointScale != fileNode->coarsePointScale)
+					{
+						return true;
+					}
+					for (auto& childNode : fileNode->children)
+					{
+						bool nextFile = std::find(nextNodes.begin(), nextNodes.end(), childNode.get()) != nextNodes.end();
+						if (nextFile ? (exportMode != ExportMode::_3DTILES && childNode->level >= _coarseLevels) : (childNode->level >= _coarseLevels || refined(childNode.get())))
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+				if (refined(node))
+				{
+					// an archive entry is replaced by appending it again, the index points to the last one
+					bool replaceFile = !_archive;
+					_deferredWrites.push_back([writeFile, saveFileName, replaceFile]() { return replaceFile ? ReplaceNodeFile(writeFile, saveFileName) : writeFile(saveFileName); });
+				}
+			}
+			else
+			{
+				_writeQueue->Push([writeFile, saveFileName]() { return writeFile(saveFileName); });
+			}
+
+			// recursive nodes in the next files
+			for (auto nextNode : nextNodes)
+			{
+				if (!ExportTree(pointSet, nextNode, boundingBoxLevel0, saveFilePath, strBlock, exportMode))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool TileToLOD::ExportCopc(const std::vector<PointCI> *pointSet, TileNode* root, const osg::BoundingBox& boundingBox, const std::string& saveFileName)
+		{
+			size_t pointNum = 0;
+			std::function<void(TileNode*)> countPoints = [&](TileNode* node)
+			{
+				pointNum += node->pointIndex.size();
+				for (auto& childNode : node->children)
+				{
+					countPoints(childNode.get());
+				}
+			};
+			countPoints(root);
+
+			// laz is one stream, nodes are written in order on this thread
+			CopcWriter writer;
+			if (!writer.Open(saveFileName, root->boundingBox, boundingBox, _offset, PointSpacing(pointSet, root), pointNum))
+			{
+				return false;
+			}
+			std::vector<osg::Vec3ub> colors;
+			std::function<bool(TileNode*, int, int, int, int)> writeNode = [&](TileNode* node, int level, int x, int y, int z)
+			{
+				colors.resize(node->pointIndex.size());
+				if (colors.size())
+				{
+					Colorize(pointSet, node->pointIndex.data(), node->pointIndex.size(), colors.data());
+				}
+				if (!writer.WriteNode(level, x, y, z, pointSet, node->pointIndex, colors.data()))
+				{
+					return false;
+				}
+				osg::Vec3 mid = node->boundingBox.center();
+				for (auto& childNode : node->children)
+				{
+					osg::Vec3 childMid = childNode->boundingBox.center();
+					if (!writeNode(childNode.get(), level + 1, x * 2 + (childMid.x() > mid.x()), y * 2 + (childMid.y() > mid.y()), z * 2 + (childMid.z() > mid.z())))
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+			return writeNode(root, 0, 0, 0, 0) && writer.Close();
+		}
+
+		Tile3dtiles TileToLOD::MakeTile3dtiles(const std::vector<PointCI> *pointSet, TileNode* node, const std::string& strBlock)
+		{
+			// refine into the children as PagingRange pages them in
+			Tile3dtiles tile;
+			tile.bb = node->boundingBox;
+			tile.geometricError = node->children.empty() ? 0. : GeometricError(PointSpacing(pointSet, node));
+			tile.content = NodeFileName(strBlock, node->level, node->childNo, NodeFileFormat(ExportMode::_3DTILES));
+			for (auto& childNode : node->children)
+			{
+				tile.children.push_back(MakeTile3dtiles(pointSet, childNode.get(), strBlock));
+			}
+			return tile;
+		}
+
+		void TileToLOD::ExportTileset(const std::vector<PointCI> *pointSet, TileNode* root, const std::string& saveFilePath, const std::string& strBlock)
+		{
+			std::shared_ptr<Tile3dtiles> tile = std::make_shared<Tile3dtiles>(MakeTile3dtiles(pointSet, root, strBlock));
+			std::string saveFileName = saveFilePath + "/tileset.json";
+			std::function<bool(const std::string&)> writeFile = [tile](const std::string& fileName)
+			{
+				return GenerateTileset(*tile, osg::Vec3d(0, 0, 0), fileName);
+			};
+			if (_phase == ProgressivePhase::Refine)
+			{
+				// the coarse tileset stays in use until the refined node files are on disk
+				_deferredWrites.push_back([writeFile, saveFileName]() { return ReplaceNodeFile(writeFile, saveFileName); });
+			}
+			else
+			{
+				_writeQueue->Push([writeFile, saveFileName]() { return writeFile(saveFileName); });
 			}
-			return true;
 		}
 	}
 }
\ No newline at end of file
@@ -1,6 +1,15 @@
 #pragma once
 
 #include "pointCI.h"
+#include "writeQueue.h"
+#include "c3mx.h"
+#include "c3dtiles.h"
+#include "archive.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <random>
 
 #include <osg/BoundingBox>
 #include <osg/ref_ptr>
@@ -10,6 +19,7 @@
 #include <osg/ProxyNode>
 #include <osg/Vec3>
 #include <osg/Vec4>
+#include <osg/Vec4ub>
 #include <osg/MatrixTransform>
 #include <osg/LineWidth>
 #include <osg/Point>
@@ -50,7 +60,81 @@ namespace seed
 		enum ExportMode
 		{
 			OSGB = 0,
-			_3MX = 1
+			_3MX = 1,
+			_3DTILES = 2,	// tileset.json per tile linking .pnts node files
+			COPC = 3		// one .copc.laz per tile, octree nodes as laz chunks
+		};
+
+		struct NodeChild
+		{
+			std::string fileName;
+			osg::BoundingBox boundingBox;
+			double range;
+		};
+
+		// lod tree node held in memory between build and export
+		struct TileNode
+		{
+			unsigned int level;
+			unsigned int childNo;
+			osg::BoundingBox boundingBox;
+			std::vector<unsigned int> pointIndex;
+			std::vector<std::shared_ptr<TileNode>> children;
+			float pointScale = 1.f;		// point size of the node over the point size of the leaves
+			float coarsePointScale = 1.f;	// pointScale the coarse pass wrote, refine pass only
+		};
+
+		// node of the hierarchy index, see doc/extended3mx.md
+		struct IndexNode
+		{
+			int parent;						// position of the parent in the index, -1 for the root
+			unsigned int level;
+			unsigned int childNo;
+			unsigned int pointNum;
+			osg::BoundingBox boundingBox;
+			float maxScreenDiameter;		// screen size in pixels at which the node pages in, 0 for the root
+			std::string fileName;			// node file holding the node
+		};
+
+		enum ColorFormat
+		{
+			Float4 = 0,		// osg::Vec4Array
+			UByte4 = 1,		// osg::Vec4ubArray, normalized
+			UByte3 = 2		// osg::Vec3ubArray, normalized
+		};
+
+		enum PointFormat
+		{
+			Xyz = 0,		// float xyz + rgba
+			Xyzq = 1,		// 16-bit quantized xyz + rgba
+			XyzqLzma = 2	// 16-bit quantized xyz in morton order, delta coded, lzma compressed
+		};
+
+		enum TreeMode
+		{
+			KdTree = 0,		// 2 children, split longest axis
+			QuadTree = 1,	// 4 children, split x and y
+			Octree = 2		// 8 children, split x, y and z
+		};
+
+		enum BuildEngine
+		{
+			Recursive = 0,	// BuildNode, copies point index per node
+			Morton = 1		// BuildTreeMorton, radix sorted morton codes, nodes are ranges of the sorted index
+		};
+
+		enum ProgressivePhase
+		{
+			Full = 0,		// build and write the whole tree
+			Coarse = 1,		// build and write only the top coarse levels
+			Refine = 2		// build the whole tree, write the levels below the coarse ones and replace coarse files linking to them
+		};
+
+		// split axes of one tree level and the position of their bits in the morton code
+		struct MortonLevel
+		{
+			std::vector<int> axes;
+			int shift;
 		};
 
 		class TileToLOD
@@ -58,48 +142,218 @@ namespace seed
 		public:
 			TileToLOD(unsigned int maxTreeLevel,
 				unsigned int maxPointNumPerOneNode,
+				unsigned int minPointNumPerOneNode,
 				double lodRatio,
 				float pointSize, 
 				osg::BoundingBox boundingBoxGlobal,
-				ColorMode colorMode)
+				ColorMode colorMode,
+				TreeMode treeMode,
+				ColorFormat colorFormat,
+				unsigned int bundleLevels,
+				BuildEngine buildEngine,
+				ProgressivePhase phase,
+				unsigned int coarseLevels,
+				std::shared_ptr<WriteQueue> writeQueue)
 			{
 				_maxTreeLevel = maxTreeLevel;
 				_maxPointNumPerOneNode = maxPointNumPerOneNode;
+				_minPointNumPerOneNode = minPointNumPerOneNode;
 				_lodRatio = lodRatio;
 				_pointSize = pointSize;
 				_boundingBoxGlobal = boundingBoxGlobal;
 				_colorMode = colorMode;
+				_treeMode = treeMode;
+				_colorFormat = colorFormat;
+				_bundleLevels = std::max(1u, bundleLevels);
+				_buildEngine = buildEngine;
+				_phase = coarseLevels > 0 ? phase : ProgressivePhase::Full;
+				_coarseLevels = coarseLevels;
+				_writeQueue = writeQueue;
+				_colorSeed = std::random_device()();
 				CreateColorBar();
 			}
 
 			void CreateColorBar();
 
+			// debug colors from seed, so the passes and runs over a tile agree
+			void SetColorSeed(unsigned int seed) { _colorSeed = seed; CreateColorBar(); }
+
+			// resource format of the points in 3mx mode
+			void SetPointFormat(PointFormat pointFormat) { _pointFormat = pointFormat; }
+
+			// 3mx mode, node files go into archive as entries named by their file name instead of saveFilePath
+			void SetArchive(std::shared_ptr<ArchiveWriter> archive) { _archive = archive; }
+
+			// osgb mode, compressor of the osgb plugin for node files, empty to write them uncompressed
+			void SetOsgbCompressor(const std::string& compressor) { _osgbCompressor = compressor; }
+
+			// offset of the points from the srs of the input, copc mode writes input coordinates
+			void SetOffset(const osg::Vec3d& offset) { _offset = offset; }
+
+			// osgb, 3mx and 3d tiles mode, keep the nodes of Generate for SaveHierarchyIndex
+			void SetHierarchyIndex(bool hierarchyIndex) { _hierarchyIndex = hierarchyIndex; }
+
+			// osgb and 3mx mode, coarse nodes enlarge their point size by their point spacing over the one of their leaves up to maxPointScale,
+			// their points stay drawn once the children page in, so larger points would cover the children
+			void SetMaxPointScale(float maxPointScale) { _maxPointScale = std::max(1.f, maxPointScale); }
+
+			// 3d tiles mode, maximum screen space error of the viewer, geometric errors are scaled by it so that tiles refine
+			// at the same point spacing on screen as osgb and 3mx nodes page in
+			void SetScreenSpaceError(float screenSpaceError) { _screenSpaceError = screenSpaceError; }
+
+			// queue the replacements of coarse files, call after the refined files are written
+			void CommitDeferredWrites();
+
+			// write the nodes of the last Generate as <strBlock>.index into saveFilePath or the archive,
+			// call once the node files are written, their sizes are read back
+			bool SaveHierarchyIndex(const std::string& saveFilePath, const std::string& strBlock);
+
+			// encoded size of one point in a node file
+			static unsigned int BytesPerPoint(ExportMode exportMode, ColorFormat colorFormat, PointFormat pointFormat);
+
+			// extension of the node files, empty if exportMode is not supported
+			static std::string NodeFileFormat(ExportMode exportMode);
+
+			// samples, if not null, receives representative points of the tile for GenerateOverview
 			bool Generate(const std::vector<PointCI> *pointSet,
-				const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, osg::BoundingBox& boundingBoxLevel0);
+				const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, osg::BoundingBox& boundingBoxLevel0,
+				std::vector<PointCI>* samples);
+
+			// pyramid of overview nodes above the tile roots, tiles link to the tile roots from saveFilePath,
+			// tileSamples index the samples of each tile in pointSet
+			bool GenerateOverview(const std::vector<PointCI> *pointSet,
+				const std::vector<NodeChild>& tiles, const std::vector<std::vector<unsigned int>>& tileSamples,
+				const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, osg::BoundingBox& boundingBoxOverview);
 
 		protected:
 			unsigned int _maxTreeLevel;
 			unsigned int _maxPointNumPerOneNode;
+			unsigned int _minPointNumPerOneNode;
 			double _lodRatio;
 			float _pointSize;
 			osg::BoundingBox _boundingBoxGlobal;
 			ColorMode _colorMode;
+			TreeMode _treeMode;
+			ColorFormat _colorFormat;
+			unsigned int _bundleLevels;
+			BuildEngine _buildEngine;
+			ProgressivePhase _phase;
+			unsigned int _coarseLevels;
+			std::vector<std::function<bool()>> _deferredWrites;
+			unsigned int _colorSeed;
+			PointFormat _pointFormat = PointFormat::Xyz;
+			std::shared_ptr<ArchiveWriter> _archive;
+			osg::Vec3d _offset;
+			std::string _osgbCompressor;
+			float _maxPointScale = 1.f;
+			float _screenSpaceError = 16.f;
+			bool _hierarchyIndex = false;
+			std::vector<IndexNode> _indexNodes;
+			std::map<const TileNode*, int> _indexIds;
+			std::shared_ptr<WriteQueue> _writeQueue;
 			osg::Vec4 _colorBar[256];
+			osg::Vec4ub _colorBar8Bits[256];
+			osg::Vec3ub _colorBar8BitsRGB[256];
 
 			AxisInfo FindMaxAxis(osg::BoundingBox boundingBox, osg::BoundingBox& boundingBoxLeft, osg::BoundingBox& boundingBoxRight);
 
-			bool BuildNode(const std::vector<PointCI> *pointSet,
+			unsigned int SplitBoundingBox(const osg::BoundingBox& boundingBox, std::vector<int>& splitAxes, std::vector<osg::BoundingBox>& childBoundingBoxes);
+
+			static unsigned int SplitBoundingBoxOnAxes(const osg::BoundingBox& boundingBox, const std::vector<int>& splitAxes, std::vector<osg::BoundingBox>& childBoundingBoxes);
+
+			std::shared_ptr<TileNode> BuildNode(const std::vector<PointCI> *pointSet,
 				std::vector<unsigned int> &pointIndex,
 				osg::BoundingBox boundingBox,
+				unsigned int level,
+				unsigned int childNo);
+
+			std::shared_ptr<TileNode> BuildTreeMorton(const std::vector<PointCI> *pointSet, osg::BoundingBox boundingBox);
+
+			std::shared_ptr<TileNode> BuildNodeMorton(std::vector<uint64_t>& codes, std::vector<unsigned int>& index,
+				std::vector<uint64_t>& codesScratch, std::vector<unsigned int>& indexScratch,
+				size_t begin, size_t end,
+				osg::BoundingBox boundingBox,
+				const std::vector<MortonLevel>& levels,
+				unsigned int level,
+				unsigned int childNo);
+
+			// fold leaves with less than _minPointNumPerOneNode points into their parent
+			void MergeSmallLeaves(TileNode* node);
+
+			// tile receives the node and its descendants as 3d tiles
+			std::shared_ptr<TileNode> ExportOverviewNode(const std::vector<PointCI> *pointSet,
+				const std::vector<NodeChild>& tiles, const std::vector<std::vector<unsigned int>>& tileSamples,
+				std::vector<unsigned int>& tileIds, unsigned int level, unsigned int childNo,
+				const std::string& saveFilePath, const std::string& strBlock, ExportMode exportMode, Tile3dtiles& tile);
+
+			// pixels the point spacing of a node covers on screen when its children page in
+			double RefinePixels() const { return 4. * _lodRatio; }
+
+			// screen size in pixels at which a child of a node with parentSpacing pages in
+			double PagingRange(double parentSpacing, const osg::BoundingBox& childBoundingBox, double fallback);
+
+			// 3d tiles geometric error of a node with spacing, its children show at the same spacing on screen as PagingRange pages them in
+			double GeometricError(double spacing);
+
+			// mean distance between the points of node
+			double PointSpacing(const std::vector<PointCI> *pointSet, TileNode* node);
+
+			// set pointScale of node and its descendants, leafSpacing and leafNum accumulate the spacing of the leaves below node.
+			// coarse sets coarsePointScale instead, with the last coarse level as leaves as in the coarse pass
+			void ScalePointSize(const std::vector<PointCI> *pointSet, TileNode* node, bool coarse, double& leafSpacing, unsigned int& leafNum);
+
+			static std::string NodeFileName(const std::string& strBlock, unsigned int level, unsigned int childNo, const std::string& format);
+
+			void AddIndexNode(const TileNode* node, const TileNode* parent, double range);
+
+			// node and its descendants not in nextNodes are held by fileName
+			void SetIndexFile(const TileNode* node, const std::vector<TileNode*>& nextNodes, const std::string& fileName);
+
+			bool ExportTree(const std::vector<PointCI> *pointSet,
+				TileNode* node,
 				osg::BoundingBox boundingBoxLevel0,
 				const std::string& saveFilePath,
 				const std::string& strBlock,
-				unsigned int level,
-				unsigned int childNo,
 				ExportMode exportMode);
 
+			// copc mode, the tree below root as saveFileName, root is the root voxel of an octree
+			bool ExportCopc(const std::vector<PointCI> *pointSet, TileNode* root, const osg::BoundingBox& boundingBox, const std::string& saveFileName);
+
+			Tile3dtiles MakeTile3dtiles(const std::vector<PointCI> *pointSet, TileNode* node, const std::string& strBlock);
+
+			// 3d tiles mode, queue saveFilePath/tileset.json over the node files of the tree below root
+			void ExportTileset(const std::vector<PointCI> *pointSet, TileNode* root, const std::string& saveFilePath, const std::string& strBlock);
+
+			const osg::Vec4* GetColorBar(osg::Vec4*) { return _colorBar; }
+			const osg::Vec4ub* GetColorBar(osg::Vec4ub*) { return _colorBar8Bits; }
+			const osg::Vec3ub* GetColorBar(osg::Vec3ub*) { return _colorBar8BitsRGB; }
+
+			template<ColorMode mode, typename ColorT>
+			void ColorKernel(const std::vector<PointCI> *pointSet,
+				const unsigned int* pointIndex, size_t pointNum, ColorT* colors);
+
+			template<typename ColorT>
+			void Colorize(const std::vector<PointCI> *pointSet,
+				const unsigned int* pointIndex, size_t pointNum, ColorT* colors);
+
 			osg::Geode *MakeNodeGeode(const std::vector<PointCI> *pointSet,
-				std::vector<unsigned int> &pointIndex, ExportMode exportMode);
+				std::vector<unsigned int> &pointIndex, float pointSize, ExportMode exportMode);
+
+			// add node and its descendants down to _bundleLevels to nodes, returns ids of the added top nodes,
+			// children below the bundle are appended to nextNodes
+			std::vector<std::string> MakeNode3mx(const std::vector<PointCI> *pointSet,
+				TileNode* node, unsigned int depth, const std::vector<NodeChild>& children,
+				std::vector<Node3mx>& nodes, std::vector<Resource3mx>& resources,
+				const std::function<std::vector<NodeChild>(TileNode*)>& makeChildren,
+				std::vector<TileNode*>& nextNodes);
+
+			// make the file content of node, returns a writer to run on the write queue,
+			// nextNodes receives the nodes which need files of their own
+			std::function<bool(const std::string&)> ExportNode(const std::vector<PointCI> *pointSet,
+				TileNode* node, const std::vector<NodeChild>& children,
+				const std::function<std::vector<NodeChild>(TileNode*)>& makeChildren,
+				ExportMode exportMode,
+				std::vector<TileNode*>& nextNodes);
 		};
 
 	};
@@ -484,6 +484,13 @@ laszip_write_indexed_point(
     laszip_POINTER                     pointer
 );
 
+/*---------------------------------------------------------------------------*/
+// end the current chunk, needs laszip_set_chunk_size with U32_MAX for variable chunks
+LASZIP_API laszip_I32
+laszip_chunk(
+    laszip_POINTER                     pointer
+);
+
 /*---------------------------------------------------------------------------*/
 LASZIP_API laszip_I32
 laszip_update_inventory(
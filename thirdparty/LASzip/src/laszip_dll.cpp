@@ -3023,6 +3023,40 @@ laszip_write_indexed_point(
   return 0;
 }
 
+/*---------------------------------------------------------------------------*/
+LASZIP_API laszip_I32
+laszip_chunk(
+    laszip_POINTER                     pointer
+)
+{
+  if (pointer == 0) return 1;
+  laszip_dll_struct* laszip_dll = (laszip_dll_struct*)pointer;
+
+  try
+  {
+    if (laszip_dll->writer == 0)
+    {
+      sprintf(laszip_dll->error, "chunking writer before it was opened");
+      return 1;
+    }
+
+    // only a compressing writer with variable chunk size (U32_MAX) ends chunks on request
+    if (!laszip_dll->writer->chunk())
+    {
+      sprintf(laszip_dll->error, "chunk of LASwritePoint failed");
+      return 1;
+    }
+  }
+  catch (...)
+  {
+    sprintf(laszip_dll->error, "internal error in laszip_chunk");
+    return 1;
+  }
+
+  laszip_dll->error[0] = '\0';
+  return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 LASZIP_API laszip_I32
 laszip_update_inventory(